@@ -0,0 +1,60 @@
+/**
+ * AllocCounter.cpp
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#include "AllocCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<uint64_t> allocations(0);
+
+void *countedAllocate(size_t bytes) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  return std::malloc(bytes == 0 ? 1 : bytes);
+}
+
+} // namespace
+
+namespace bench {
+
+uint64_t getAllocationCount() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+} /* namespace bench */
+
+void *operator new(size_t bytes) {
+  void *p = countedAllocate(bytes);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  return p;
+}
+
+void *operator new[](size_t bytes) { return operator new(bytes); }
+
+void *operator new(size_t bytes, const std::nothrow_t &) noexcept {
+  return countedAllocate(bytes);
+}
+
+void *operator new[](size_t bytes, const std::nothrow_t &) noexcept {
+  return countedAllocate(bytes);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete[](void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  std::free(p);
+}
@@ -0,0 +1,24 @@
+/**
+ * AllocCounter.h
+ *
+ * Counts heap allocations made anywhere in the process, by replacing the
+ * global operator new, so the benchmark can check how many a transfer
+ * makes per packet.
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#ifndef AllocCounter_H_
+#define AllocCounter_H_
+
+#include <cstdint>
+
+namespace bench {
+
+// Calls to any form of operator new since the program started.
+uint64_t getAllocationCount();
+
+} /* namespace bench */
+
+#endif /* AllocCounter_H_ */
@@ -0,0 +1,113 @@
+/**
+ * LoopbackNetwork.cpp
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#include "LoopbackNetwork.h"
+
+#include <chrono>
+
+namespace bench {
+
+namespace {
+
+int64_t nowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+LoopbackNetworkLayer::LoopbackNetworkLayer(LoopbackLink *link, int direction)
+    : framework::NetworkLayer(nullptr), link(link), direction(direction) {}
+
+void LoopbackNetworkLayer::sendPacket(framework::Packet packet) {
+  link->send(direction, std::move(packet));
+}
+
+void LoopbackNetworkLayer::sendPackets(
+    std::vector<framework::Packet> *packets) {
+  for (framework::Packet &packet : *packets)
+    link->send(direction, std::move(packet));
+  packets->clear();
+}
+
+bool LoopbackNetworkLayer::receivePacket(framework::Packet *packet) {
+  single.clear();
+  if (link->receive(1 - direction, &single, 1) == 0)
+    return false;
+  packet->swap(single.front());
+  return true;
+}
+
+size_t LoopbackNetworkLayer::receivePackets(
+    std::vector<framework::Packet> *packets) {
+  return link->receive(1 - direction, packets, (size_t)-1);
+}
+
+LoopbackLink::LoopbackLink(const LinkParams &params)
+    : params(params), rng(params.seed), senderSide(this, 0),
+      receiverSide(this, 1) {}
+
+LoopbackNetworkLayer *LoopbackLink::getSenderSide() { return &senderSide; }
+
+LoopbackNetworkLayer *LoopbackLink::getReceiverSide() { return &receiverSide; }
+
+uint64_t LoopbackLink::getPacketsSent(int direction) const {
+  std::lock_guard<std::mutex> guard(lock);
+  return sent[direction];
+}
+
+// Queues the packet behind earlier ones at the bottleneck rate, then drops
+// it or schedules its arrival after the propagation delay plus jitter.
+void LoopbackLink::send(int direction, framework::Packet packet) {
+  std::lock_guard<std::mutex> guard(lock);
+  sent[direction]++;
+  int64_t now = nowUs();
+  int64_t &freeUs = linkFreeUs[direction];
+  if (freeUs < now)
+    freeUs = now;
+  freeUs += (int64_t)(1e6 / params.ratePps);
+
+  std::uniform_real_distribution<double> uniform(0, 1);
+  if (uniform(rng) < params.loss)
+    return;
+  int64_t delay = params.delayUs + (int64_t)(uniform(rng) * params.jitterUs);
+  inFlight.push(Event{freeUs + delay, nextOrder++, direction,
+                      std::move(packet)});
+}
+
+// Moves everything whose time has come into the arrival queues, then hands
+// out up to max packets travelling in direction.
+size_t LoopbackLink::receive(int direction,
+                             std::vector<framework::Packet> *packets,
+                             size_t max) {
+  std::lock_guard<std::mutex> guard(lock);
+  int64_t now = nowUs();
+  while (!inFlight.empty() && inFlight.top().deliverUs <= now) {
+    Event &e = const_cast<Event &>(inFlight.top());
+    arrived[e.direction].push_back(std::move(e.packet));
+    inFlight.pop();
+  }
+
+  size_t n = 0;
+  std::vector<framework::Packet> &queue = arrived[direction];
+  size_t &head = arrivedHead[direction];
+  while (n < max && head < queue.size()) {
+    packets->push_back(std::move(queue[head++]));
+    n++;
+  }
+  if (head == queue.size()) {
+    queue.clear();
+    head = 0;
+  } else if (head > queue.size() / 2) {
+    queue.erase(queue.begin(), queue.begin() + head);
+    head = 0;
+  }
+  return n;
+}
+
+} /* namespace bench */
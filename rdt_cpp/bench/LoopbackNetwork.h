@@ -0,0 +1,101 @@
+/**
+ * LoopbackNetwork.h
+ *
+ * In-process stand-in for the challenge server: a rate-limited link with
+ * random loss, delay and jitter between two NetworkLayer endpoints, so
+ * protocol variants can be compared offline and reproducibly.
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#ifndef LoopbackNetwork_H_
+#define LoopbackNetwork_H_
+
+#include "../framework/NetworkLayer.h"
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <vector>
+
+namespace bench {
+
+struct LinkParams {
+  double loss = 0.1;       // per-packet drop probability, both directions
+  int64_t delayUs = 20000; // one-way propagation delay
+  int64_t jitterUs = 5000; // extra uniform delay in [0, jitterUs)
+  double ratePps = 2000;   // bottleneck rate per direction
+  uint32_t seed = 12345;
+};
+
+class LoopbackLink;
+
+// One end of a LoopbackLink; direction 0 carries sender to receiver.
+class LoopbackNetworkLayer : public framework::NetworkLayer {
+
+public:
+  LoopbackNetworkLayer(LoopbackLink *link, int direction);
+
+  using framework::NetworkLayer::receivePacket;
+  using framework::NetworkLayer::receivePackets;
+  using framework::NetworkLayer::sendPacket;
+  using framework::NetworkLayer::sendPackets;
+  void sendPacket(framework::Packet packet);
+  void sendPackets(std::vector<framework::Packet> *packets);
+  bool receivePacket(framework::Packet *packet);
+  size_t receivePackets(std::vector<framework::Packet> *packets);
+
+private:
+  LoopbackLink *link;
+  int direction;
+  std::vector<framework::Packet> single; // receivePacket's, kept for reuse
+};
+
+class LoopbackLink {
+
+public:
+  explicit LoopbackLink(const LinkParams &params);
+
+  LoopbackNetworkLayer *getSenderSide();
+  LoopbackNetworkLayer *getReceiverSide();
+
+  // Packets handed to the link in a direction, lost ones included.
+  uint64_t getPacketsSent(int direction) const;
+
+private:
+  friend class LoopbackNetworkLayer;
+
+  struct Event {
+    int64_t deliverUs;
+    uint64_t order;
+    int direction;
+    framework::Packet packet;
+    bool operator<(const Event &o) const {
+      return deliverUs != o.deliverUs ? deliverUs > o.deliverUs
+                                      : order > o.order;
+    }
+  };
+
+  LinkParams params;
+  mutable std::mutex lock;
+  std::priority_queue<Event> inFlight;
+  // Arrived packets from arrivedHead on; a vector rather than a deque so
+  // that steady traffic reuses its storage instead of allocating blocks.
+  std::vector<framework::Packet> arrived[2];
+  size_t arrivedHead[2] = {0, 0};
+  std::mt19937 rng;
+  uint64_t nextOrder = 0;
+  uint64_t sent[2] = {0, 0};
+  int64_t linkFreeUs[2] = {0, 0}; // when each direction's queue drains
+  LoopbackNetworkLayer senderSide;
+  LoopbackNetworkLayer receiverSide;
+
+  void send(int direction, framework::Packet packet);
+  size_t receive(int direction, std::vector<framework::Packet> *packets,
+                 size_t max);
+};
+
+} /* namespace bench */
+
+#endif /* LoopbackNetwork_H_ */
@@ -0,0 +1,203 @@
+/**
+ * ProtocolBench.cpp
+ *
+ * Runs every registered protocol variant over the same lossy loopback link
+ * and prints one row per variant and file, so variants can be compared in
+ * a single run without the challenge server. The allocs column is heap
+ * allocations per data packet over the middle half of the transfer, when
+ * buffers should all be recycled and it ought to read 0. Before the table,
+ * the cost of a packet buffer built on one thread and dropped on another,
+ * as the protocol and the client's event loop do, is timed on its own.
+ *
+ * Usage: protocolbench [loss] [file ...]   (defaults: 0.1, files 1 3 6)
+ * Run from rdt_cpp so the rdtcInput files are found.
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#include "../framework/IRDTProtocol.h"
+#include "../framework/Packet.h"
+#include "../framework/SpscRing.h"
+#include "../framework/Utils.h"
+#include "../my_protocol/MyProtocol.h"
+#include "AllocCounter.h"
+#include "LoopbackNetwork.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct BenchResult {
+  bool ok;
+  int64_t elapsedMs;
+  uint64_t dataPackets;
+  uint64_t ackPackets;
+  double allocsPerPacket;
+};
+
+struct AllocSample {
+  uint64_t packets;
+  uint64_t allocations;
+};
+
+// Allocations per data packet between the samples taken a quarter and three
+// quarters of the way through the data packets sent.
+double steadyAllocsPerPacket(const std::vector<AllocSample> &samples,
+                             uint64_t totalPackets) {
+  const AllocSample *from = nullptr;
+  const AllocSample *to = nullptr;
+  for (const AllocSample &sample : samples) {
+    if (from == nullptr && sample.packets >= totalPackets / 4)
+      from = &sample;
+    if (to == nullptr && sample.packets >= totalPackets * 3 / 4)
+      to = &sample;
+  }
+  if (from == nullptr || to == nullptr || to->packets == from->packets)
+    return 0;
+  return (double)(to->allocations - from->allocations) /
+         (double)(to->packets - from->packets);
+}
+
+// Nanoseconds per packet buffer allocated on this thread, handed through a
+// ring and freed on another, and heap allocations per packet meanwhile.
+void timePoolHandoff(double &nsPerPacket, double &allocsPerPacket) {
+  const size_t PACKETS = 1 << 20;
+  framework::SpscRing<framework::Packet> ring(1024);
+  std::thread consumer([&] {
+    size_t taken = 0;
+    while (taken < PACKETS) {
+      size_t n = ring.tryPopAll([](framework::Packet &slot) {
+        framework::Packet dropped;
+        dropped.swap(slot);
+      });
+      if (n == 0)
+        std::this_thread::yield();
+      taken += n;
+    }
+  });
+
+  // Warm the pool up, so slab growth is not counted.
+  std::vector<framework::Packet> warm(2048, framework::Packet(200));
+  warm.clear();
+
+  uint64_t allocationsBefore = bench::getAllocationCount();
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (size_t sent = 0; sent < PACKETS;) {
+    framework::Packet packet(200);
+    packet[0] = (uint8_t)sent;
+    while (!ring.tryPush([&](framework::Packet &slot) { slot.swap(packet); }))
+      std::this_thread::yield();
+    sent++;
+  }
+  consumer.join();
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  nsPerPacket =
+      (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+          .count() /
+      PACKETS;
+  allocsPerPacket =
+      (double)(bench::getAllocationCount() - allocationsBefore) / PACKETS;
+}
+
+BenchResult runTransfer(const std::string &variant, const std::string &file,
+                        const bench::LinkParams &params) {
+  bench::LoopbackLink link(params);
+  std::unique_ptr<framework::IRDTProtocol> sender(
+      my_protocol::createProtocolVariant(variant));
+  std::unique_ptr<framework::IRDTProtocol> receiver(
+      my_protocol::createProtocolVariant(variant));
+  sender->setNetworkLayer(link.getSenderSide());
+  sender->setFileID(file);
+  receiver->setNetworkLayer(link.getReceiverSide());
+  receiver->setFileID(file);
+
+  // Sampled into reserved storage so that sampling allocates nothing.
+  std::vector<AllocSample> samples;
+  samples.reserve(1 << 16);
+  std::atomic<bool> sampling(true);
+  std::thread sampler([&] {
+    while (sampling && samples.size() < samples.capacity()) {
+      samples.push_back(
+          AllocSample{link.getPacketsSent(0), bench::getAllocationCount()});
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::thread senderThread(&framework::IRDTProtocol::sender, sender.get());
+  std::vector<int32_t> received = receiver->receiver();
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  sampling = false;
+  sampler.join();
+
+  // The sender may still be waiting for a lost final ACK.
+  sender->setStop();
+  senderThread.join();
+
+  std::vector<int32_t> original = framework::getFileContents(file);
+  BenchResult result;
+  result.ok = original.size() == received.size();
+  for (size_t i = 0; result.ok && i < original.size(); i++)
+    result.ok = ((original[i] ^ received[i]) & 0xFF) == 0;
+  result.elapsedMs =
+      std::chrono::duration_cast<std::chrono::milliseconds>(end - start)
+          .count();
+  result.dataPackets = link.getPacketsSent(0);
+  result.ackPackets = link.getPacketsSent(1);
+  result.allocsPerPacket = steadyAllocsPerPacket(samples, result.dataPackets);
+  return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  bench::LinkParams params;
+  if (argc > 1)
+    params.loss = atof(argv[1]);
+  std::vector<std::string> files;
+  for (int i = 2; i < argc; i++)
+    files.push_back(argv[i]);
+  if (files.empty())
+    files = {"1", "3", "6"};
+
+  printf("loss %.2f, delay %lld us, jitter %lld us, %.0f pkt/s\n", params.loss,
+         (long long)params.delayUs, (long long)params.jitterUs,
+         params.ratePps);
+  double poolNs, poolAllocs;
+  timePoolHandoff(poolNs, poolAllocs);
+  printf("packet handoff between threads: %.1f ns, %.2f allocs per packet\n",
+         poolNs, poolAllocs);
+  printf("%-12s %4s %4s %8s %8s %8s %8s\n", "variant", "file", "ok", "ms",
+         "data", "acks", "allocs");
+
+  bool allOk = true;
+  for (const std::string &variant : my_protocol::protocolVariantNames()) {
+    for (const std::string &file : files) {
+      // The protocols narrate on cout; keep the table readable.
+      std::ostringstream sink;
+      std::streambuf *saved = std::cout.rdbuf(sink.rdbuf());
+      BenchResult r = runTransfer(variant, file, params);
+      std::cout.rdbuf(saved);
+
+      allOk = allOk && r.ok;
+      printf("%-12s %4s %4s %8lld %8llu %8llu %8.2f\n", variant.c_str(),
+             file.c_str(), r.ok ? "yes" : "NO", (long long)r.elapsedMs,
+             (unsigned long long)r.dataPackets,
+             (unsigned long long)r.ackPackets, r.allocsPerPacket);
+      fflush(stdout);
+    }
+  }
+  return allOk ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+/**
+ * ControlLine.h
+ *
+ * A control message taken apart in place. TextSpan is a pointer and a
+ * length into the buffer the message was read into, so splitting a line
+ * into its verb and arguments copies and allocates nothing. Spans are only
+ * valid until that buffer next changes.
+ */
+
+#ifndef CONTROLLINE_H_
+#define CONTROLLINE_H_
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace framework {
+
+    struct TextSpan {
+        const char *data;
+        size_t size;
+
+        TextSpan() : data(nullptr), size(0) {}
+        TextSpan(const char *data, size_t size) : data(data), size(size) {}
+
+        bool empty() const {
+            return size == 0;
+        }
+
+        bool startsWith(const char *prefix) const {
+            size_t length = strlen(prefix);
+            return length <= size && memcmp(data, prefix, length) == 0;
+        }
+
+        std::string str() const {
+            return std::string(data, size);
+        }
+    };
+
+    class ControlLine {
+    public:
+        /**
+         * @param message a control message without protocol prefix or
+         * line end
+         */
+        explicit ControlLine(TextSpan message) : line(message) {
+            const char *space = static_cast<const char *>(
+                memchr(line.data, ' ', line.size));
+            if (space == nullptr) {
+                verb = line;
+            } else {
+                verb = TextSpan(line.data, space - line.data);
+                rest = TextSpan(space + 1,
+                    line.size - (space + 1 - line.data));
+            }
+        }
+
+        /**
+         * @return the first word of the message
+         */
+        TextSpan getVerb() const {
+            return verb;
+        }
+
+        /**
+         * @return everything after the first space, empty if there is none
+         */
+        TextSpan getRest() const {
+            return rest;
+        }
+
+        /**
+         * @return the index-th space separated word after the verb, counting
+         * from 0, or an empty span if there are fewer
+         */
+        TextSpan getArgument(size_t index) const {
+            const char *p = rest.data;
+            const char *end = rest.data + rest.size;
+            while (p != nullptr && p < end) {
+                const char *space = static_cast<const char *>(
+                    memchr(p, ' ', end - p));
+                const char *wordEnd = space == nullptr ? end : space;
+                if (index-- == 0)
+                    return TextSpan(p, wordEnd - p);
+                p = space == nullptr ? nullptr : space + 1;
+            }
+            return TextSpan();
+        }
+
+    private:
+        TextSpan line;
+        TextSpan verb;
+        TextSpan rest;
+    };
+
+} /* namespace framework */
+
+#endif /* CONTROLLINE_H_ */
@@ -16,13 +16,25 @@
 
 #include "DRDTChallengeClient.h"
 
+#include <algorithm>
 #include <chrono>
 #include <thread>
 
 namespace framework {
 
     DRDTChallengeClient::DRDTChallengeClient(std::string serverAddress,
-        int32_t serverPort, std::string clientGroupKey) {
+        int32_t serverPort, std::string clientGroupKey)
+        : inputPacketRing(PACKET_RING_SLOTS),
+          outputPacketRing(PACKET_RING_SLOTS),
+          packetsSent(MetricsRegistry::shared().counter("client.packets_sent")),
+          packetsReceived(MetricsRegistry::shared().counter("client.packets_received")),
+          inputBacklogged(MetricsRegistry::shared().counter("client.input_backlogged")),
+          inputQueueDepth(MetricsRegistry::shared().gauge("client.input_queue_depth")),
+          outputQueueDepth(MetricsRegistry::shared().gauge("client.output_queue_depth")),
+          waitStartTime(MetricsRegistry::shared().counter("client.phase.wait_start_us")),
+          simulationTime(MetricsRegistry::shared().counter("client.phase.simulation_us")),
+          checksumTime(MetricsRegistry::shared().counter("client.phase.checksum_us")),
+          phaseStart(std::chrono::steady_clock::now()) {
         if (clientGroupKey == "get-your-key-from-the-website") {
             std::cerr << "Please set your group key in Program.cpp" << std::endl;
             exit(EXIT_FAILURE);
@@ -39,6 +51,12 @@ namespace framework {
     }
 
     DRDTChallengeClient::~DRDTChallengeClient() {
+#ifdef __linux__
+        if (epollFd != -1)
+            close(epollFd);
+        if (wakeFd != -1)
+            close(wakeFd);
+#endif
     }
 
     void DRDTChallengeClient::clientConnect() {
@@ -89,6 +107,7 @@ namespace framework {
         x = fcntl(sock, F_GETFL, 0);
         fcntl(sock, F_SETFL, x | O_NONBLOCK);
 #endif
+        setupEventLoop();
 
         // expect hello message
         if (this->getControlMessageBlocking() != "REGISTER") {
@@ -148,7 +167,7 @@ namespace framework {
      * @return whether the output buffer is empty
      */
     bool DRDTChallengeClient::isOutputBufferEmpty() {
-        return this->outputPacketBuffer.size() == 0;
+        return this->outputPacketRing.empty();
     }
 
     /**
@@ -163,6 +182,7 @@ namespace framework {
     }
 
     void DRDTChallengeClient::sendChecksum(std::string type, std::string filename) {
+        PhaseTimer timer(checksumTime);
         std::ifstream ifs(filename, std::ifstream::binary);
 
         if (!ifs.good()) {
@@ -171,11 +191,31 @@ namespace framework {
             exit(EXIT_FAILURE);
         }
 
-        std::string fileContents((std::istreambuf_iterator<char>(ifs)),
-            (std::istreambuf_iterator<char>()));
-        std::string crcData = this->challenge + fileContents;
+        // The CRC of challenge followed by the file, continued chunk by chunk
+        // from the challenge's instead of over a concatenated copy.
+        uint32_t crc = ::crc32_fast(this->challenge.data(), this->challenge.size(), 0);
+        std::vector<char> chunk(CHECKSUM_CHUNK_BYTES);
+        while (ifs) {
+            ifs.read(chunk.data(), chunk.size());
+            crc = ::crc32_fast(chunk.data(), (size_t)ifs.gcount(), crc);
+        }
+        this->sendControlMessage("CHECKSUM " + type + " " + std::to_string(crc));
+    }
 
-        uint32_t crc = ::crc32_1byte(crcData.c_str(), crcData.length(), 0);
+    /**
+     * Sends the checksum of contents, one byte per integer, exactly as for
+     * a file holding them, without that file having to be written first.
+     */
+    void DRDTChallengeClient::sendChecksum(std::string type, const std::vector<int32_t> &contents) {
+        PhaseTimer timer(checksumTime);
+        uint32_t crc = ::crc32_fast(this->challenge.data(), this->challenge.size(), 0);
+        std::vector<uint8_t> chunk(CHECKSUM_CHUNK_BYTES);
+        for (size_t at = 0; at < contents.size(); at += chunk.size()) {
+            size_t count = std::min(chunk.size(), contents.size() - at);
+            for (size_t i = 0; i < count; i++)
+                chunk[i] = (uint8_t)contents[at + i];
+            crc = ::crc32_fast(chunk.data(), count, crc);
+        }
         this->sendControlMessage("CHECKSUM " + type + " " + std::to_string(crc));
     }
 
@@ -183,15 +223,25 @@ namespace framework {
         // stop simulation
         simulationStarted = false;
         simulationFinished = true;
+        // The event loop may be asleep with nothing to wait for but this.
+        wakeEventLoop();
 
         // stop the message loop. For the sender this is already joined....
         if(!isSender){
             this->eventLoopThread.join();
         }        
-        
+
         // close comms        
         // std::this_thread::sleep_for(std::chrono::milliseconds(1000)); // Why was this here?
         this->sendControlMessage("CLOSED");
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> guard(sendBufferLock);
+                if (flushSendBuffer())
+                    break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
         shutdown(this->sock, 1);
 #ifdef _MSC_VER
         closesocket(this->sock);
@@ -203,29 +253,35 @@ namespace framework {
     void DRDTChallengeClient::run() {
         bool stopThread = false;
         while (!stopThread && !simulationFinished) {
-            std::string message = "";
-            message = this->getControlMessage();
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        
-            if( message != "" ){
-                std::vector<std::string> splitMessage = this->split(message, ' ');
-
-                if (splitMessage.size() > 0 && splitMessage.at(0).find("FAIL") == 0) {
-                    if (splitMessage.size() > 1) {
-                        std::cout << "Failure: "
-                            << message.substr(message.find(' ') + 1) << std::endl;
+            readSocket();
+
+            // Every complete line is dispatched now, so a burst from the
+            // server costs one wakeup rather than one per line.
+            bool dispatched = false;
+            TextSpan message;
+            while (!stopThread && !simulationFinished
+                && takeControlMessage(message)) {
+                dispatched = true;
+                ControlLine line(message);
+                TextSpan verb = line.getVerb();
+
+                if (verb.startsWith("FAIL")) {
+                    if (!line.getRest().empty()) {
+                        std::cout << "Failure: " << line.getRest().str()
+                            << std::endl;
                     }
-                    clearControlMessage();
                     stopThread = true;
                     simulationStarted = false;
                     simulationFinished = true;
 
                 }
-                else if (splitMessage.size() > 1 && splitMessage.at(0).find("START") == 0) {
+                else if (verb.startsWith("START") && !line.getRest().empty()) {
                     // start the simulation
-                    this->fileID = splitMessage.at(1);
-                    this->challenge = base64_decode(splitMessage.at(2));
+                    this->fileID = line.getArgument(0).str();
+                    TextSpan challenge = line.getArgument(1);
+                    this->challenge = base64_decode(challenge.str());
                     this->start();
+                    endPhase(waitStartTime);
 
                     // upload file checksum
                     if (isSender) {
@@ -233,177 +289,431 @@ namespace framework {
                     }
 
                 }
-                else if (splitMessage.size() > 0
-                    && splitMessage.at(0).find("PACKET") == 0) {
+                else if (verb.startsWith("PACKET")) {
                     // We received a packet from the server
                     if (simulationStarted) {
-                        std::vector<int32_t> packetContentsInIntegers;
-                        if (splitMessage.size() > 1) {
-                            // convert base64 string to bytes
-                            std::string packetContents = base64_decode(
-                                splitMessage.at(1));
-                            // convert 8-bit bytes to 32-bit integers
-                            packetContentsInIntegers = std::vector<int32_t>(
-                                packetContents.length());
-                            for (uint32_t i = 0; i < packetContents.length(); i++) {
-
-                                packetContentsInIntegers[i] = (packetContents[i]
-                                    & 0x000000ff);
-                            }
-
-                        }
-                        else {
-                            packetContentsInIntegers = std::vector<int32_t>(0);
-                        }
-
-                        this->inputPacketBufferLock.lock();
-                        this->inputPacketBuffer.push_back(packetContentsInIntegers);
-                        this->inputPacketBufferLock.unlock();
+                        // decoded straight into a reused buffer, so packets
+                        // cost no allocation once it has grown
+                        TextSpan payload = line.getArgument(0);
+                        inboundPacket.resize(base64_decoded_length(payload.size));
+                        inboundPacket.resize(base64_decode(payload.data,
+                            payload.size, inboundPacket.data()));
+                        packetsReceived.add();
+                        queueInputPacket(inboundPacket);
                     }
 
                 }
-                else if (message.find("CLOSED") == 0) {
+                else if (verb.startsWith("CLOSED")) {
                     simulationStarted = false;
                     simulationFinished = true;
 
                     std::cout << "Simulation aborted!" << std::endl;
-                    if (splitMessage.size() > 1) {
-                        std::cerr << "Reason: " << message.substr(message.find(' ') + 1)
+                    if (!line.getRest().empty()) {
+                        std::cerr << "Reason: " << line.getRest().str()
                             << std::endl;
                     }
                 }
-                else if (message.find("FINISH") == 0) {
+                else if (verb.startsWith("FINISH")) {
                     simulationStarted = false;
                     simulationFinished = true;
                     
-                    if (splitMessage.size() > 1) {
-                        std::cerr << "Score: " << message.substr(message.find(' ') + 1)
-                            << std::endl;
+                    if (!line.getRest().empty()) {
+                        std::string score = line.getRest().str();
+                        std::cerr << "Score: " << score << std::endl;
+
+                        // kept whole, and its first number on its own
+                        MetricsRegistry &metrics = MetricsRegistry::shared();
+                        metrics.setLabel("server.finish", score);
+                        std::istringstream words(score);
+                        std::string word;
+                        while (words >> word) {
+                            char *end;
+                            double value = strtod(word.c_str(), &end);
+                            if (end != word.c_str()) {
+                                metrics.setValue("server.score", value);
+                                break;
+                            }
+                        }
                     }
                     
                     std::cout
                         << "Simulation finished! Check your performance on the server web interface."
                         << std::endl;
                 }
+            }
 
-                clearControlMessage();
+            if (!dispatched && connectionClosed) {
+                std::cout << "Connection to the server lost!" << std::endl;
+                simulationStarted = false;
+                simulationFinished = true;
+                break;
             }
 
-            if (simulationStarted) {
-                if (this->outputPacketBuffer.size() > 0) { // one at a time so we do check the incoming messages even with overload!
-                    outputPacketBufferLock.lock();
-                    if (this->outputPacketBuffer.size() > 0) {
-                        // If there are packets available, send one.
-                        // Note: only lowest 8-bit of integers is used.
-                        std::vector<int32_t> packetContentsInIntegers =
-                            this->outputPacketBuffer.front();
-                        this->outputPacketBuffer.pop_front();
-                        this->sendControlMessage(
-                            "TRANSMIT "
-                            + base64_encode(packetContentsInIntegers));
+            // Input the protocol had no room for goes first, in order.
+            while (!inputBacklog.empty()
+                && inputPacketRing.tryPush([this](Packet &slot) {
+                    slot.swap(inputBacklog.front());
+                })) {
+                inputBacklog.pop_front();
+            }
+
+            // Everything queued goes out in as few writes as the socket
+            // allows; what it does not take yet stays in sendBuffer.
+            bool sendBlocked;
+            {
+                std::lock_guard<std::mutex> guard(sendBufferLock);
+                if (simulationStarted) {
+                    outputQueueDepth.set((int64_t)outputPacketRing.size());
+                    while (sendBuffer.size() < SEND_BUFFER_LIMIT
+                        && outputPacketRing.tryPop([this](Packet &slot) {
+                            appendTransmit(slot);
+                        })) {
                     }
-                    outputPacketBufferLock.unlock();
                 }
+                sendBlocked = !flushSendBuffer();
             }
+            watchWritable(sendBlocked);
+
+            // Only block with nothing left to do. Announcing the sleep before
+            // the last look at the output ring pairs with the fence in
+            // wakeEventLoop, so output queued meanwhile is never missed.
+            if (hasBufferedLine())
+                continue;
+            loopSleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!simulationFinished
+                && (sendBlocked || !simulationStarted || outputPacketRing.empty())) {
+                // a full input ring only drains by polling
+                waitForWork(inputBacklog.empty() ? -1 : 1);
+            }
+            loopSleeping.store(false, std::memory_order_relaxed);
 
         }
+        endPhase(fileID.empty() ? waitStartTime : simulationTime);
     }
 
-    bool DRDTChallengeClient::receivePacket(std::vector<int32_t> *packet) {
-        if (this->inputPacketBuffer.size() > 0) {
-            this->inputPacketBufferLock.lock();
-            if (this->inputPacketBuffer.size() > 0) {
-                std::vector<int32_t> pck = this->inputPacketBuffer.front();
-                this->inputPacketBuffer.pop_front();
-                *packet = pck;
-                this->inputPacketBufferLock.unlock();
-                return true;
+    /**
+     * Event loop only. Adds the time since the last phase ended to
+     * phaseTime, and starts the next phase.
+     */
+    void DRDTChallengeClient::endPhase(Counter &phaseTime) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        phaseTime.add((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            now - phaseStart).count());
+        phaseStart = now;
+    }
+
+    /**
+     * Event loop only. Hands packet to the protocol thread, or parks it in
+     * the backlog while the input ring is full or the backlog not yet empty.
+     */
+    void DRDTChallengeClient::queueInputPacket(Packet &packet) {
+        uint32_t bytes = (uint32_t)packet.size();
+        if (!inputBacklog.empty()
+            || !inputPacketRing.tryPush([&packet](Packet &slot) {
+                slot.assign(packet.begin(), packet.end());
+            })) {
+            inputBacklog.push_back(std::move(packet));
+            inputBacklogged.add();
+        }
+        size_t depth = inputPacketRing.size() + inputBacklog.size();
+        inputQueueDepth.set((int64_t)depth);
+        trace(TRACE_CLIENT_PACKET, (uint32_t)depth, bytes);
+    }
+
+    bool DRDTChallengeClient::receivePacket(Packet *packet) {
+        return inputPacketRing.tryPop([packet](Packet &slot) {
+            packet->swap(slot);
+        });
+    }
+
+    /**
+     * Appends every queued inbound packet to packets, without locking.
+     * @return the number of packets appended
+     */
+    size_t DRDTChallengeClient::receivePackets(std::vector<Packet> *packets) {
+        return inputPacketRing.tryPopAll([packets](Packet &slot) {
+            packets->emplace_back();
+            packets->back().swap(slot);
+        });
+    }
+
+    /**
+     * Queues packet for transmission. Waits while the output ring is full,
+     * unless the simulation is over and nothing drains it any more.
+     */
+    void DRDTChallengeClient::sendPacket(Packet packet) {
+        while (!outputPacketRing.tryPush([&packet](Packet &slot) {
+                slot.swap(packet);
+            })) {
+            if (simulationFinished)
+                return;
+            wakeEventLoop();
+            std::this_thread::yield();
+        }
+        wakeEventLoop();
+    }
+
+    /**
+     * Queues a batch of packets for transmission, in order, and empties
+     * packets without giving up its capacity. The batch is published to
+     * the event loop in one step unless the output ring fills up first.
+     */
+    void DRDTChallengeClient::sendPackets(std::vector<Packet> *packets) {
+        size_t sent = 0;
+        while (sent < packets->size()) {
+            sent += outputPacketRing.tryPushMany(packets->size() - sent,
+                [packets, sent](Packet &slot, size_t i) {
+                    slot.swap((*packets)[sent + i]);
+                });
+            if (sent == packets->size() || simulationFinished)
+                break;
+            wakeEventLoop();
+            std::this_thread::yield();
+        }
+        packets->clear();
+        wakeEventLoop();
+    }
+
+    void DRDTChallengeClient::setupEventLoop() {
+#ifdef __linux__
+        epollFd = epoll_create1(0);
+        wakeFd = eventfd(0, EFD_NONBLOCK);
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = (int)sock;
+        bool ok = epollFd != -1 && wakeFd != -1
+            && epoll_ctl(epollFd, EPOLL_CTL_ADD, (int)sock, &ev) == 0;
+        ev.data.fd = wakeFd;
+        ok = ok && epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev) == 0;
+        if (!ok) {
+            std::cerr << "epoll setup failed, polling instead" << std::endl;
+            if (epollFd != -1)
+                close(epollFd);
+            epollFd = -1;
+        }
+#endif
+    }
+
+    /**
+     * Event loop only. Has waitForWork also return once the socket takes
+     * writes again.
+     */
+    void DRDTChallengeClient::watchWritable(bool watch) {
+#ifdef __linux__
+        if (epollFd == -1 || watch == writeWatched)
+            return;
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | (watch ? (uint32_t)EPOLLOUT : 0U);
+        ev.data.fd = (int)sock;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, (int)sock, &ev);
+#endif
+        writeWatched = watch;
+    }
+
+    /**
+     * Blocks until the socket is readable, wakeEventLoop is called, or
+     * timeoutMs passes (-1 for no limit).
+     */
+    void DRDTChallengeClient::waitForWork(int timeoutMs) {
+#ifdef __linux__
+        if (epollFd != -1) {
+            struct epoll_event events[2];
+            int n = epoll_wait(epollFd, events, 2, timeoutMs);
+            for (int i = 0; i < n; i++) {
+                if (events[i].data.fd == wakeFd) {
+                    uint64_t count;
+                    ssize_t nread = read(wakeFd, &count, sizeof(count));
+                    (void)nread;
+                }
             }
-            this->inputPacketBufferLock.unlock();
+            return;
         }
-        return false;
+#endif
+        (void)timeoutMs;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
 
-    void DRDTChallengeClient::sendPacket(std::vector<int32_t> packet) {
-        this->outputPacketBufferLock.lock();
-        this->outputPacketBuffer.push_back(packet);
-        this->outputPacketBufferLock.unlock();
+    /**
+     * Any thread. Wakes the event loop if it is asleep, or about to be.
+     */
+    void DRDTChallengeClient::wakeEventLoop() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!loopSleeping.load(std::memory_order_relaxed))
+            return;
+#ifdef __linux__
+        if (wakeFd != -1) {
+            uint64_t one = 1;
+            ssize_t nwritten = write(wakeFd, &one, sizeof(one));
+            (void)nwritten;
+        }
+#endif
+    }
+
+    /**
+     * @return whether a whole control message is already read
+     */
+    bool DRDTChallengeClient::hasBufferedLine() {
+        return socketBufferStr.find('\n', socketBufferPos) != std::string::npos;
     }
 
     std::string DRDTChallengeClient::getControlMessageBlocking() {
         std::string message = "";
         while (message == "") {
             message = this->getControlMessage();
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (message != "")
+                break;
+            if (connectionClosed) {
+                std::cerr << "Connection closed by server" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            waitForWork(-1);
         }
 
         return message;
     }
 
     std::string DRDTChallengeClient::getControlMessage() {
+        readSocket();
+        TextSpan message;
+        if (this->currentControlMessage == "" && takeControlMessage(message)) {
+            this->currentControlMessage = message.str();
+        }
+
+        return this->currentControlMessage;
+    }
+
+    /**
+     * Appends everything the socket has to socketBufferStr, which grows as
+     * needed.
+     */
+    void DRDTChallengeClient::readSocket() {
         char socketBuffer[BUF_SIZE];
+        for (;;) {
 #ifdef _MSC_VER
-        ssize_t nread = recv(sock, socketBuffer, BUF_SIZE, 0);
+            ssize_t nread = recv(sock, socketBuffer, BUF_SIZE, 0);
 #else
-        ssize_t nread = read(sock, socketBuffer, BUF_SIZE);
+            ssize_t nread = read(sock, socketBuffer, BUF_SIZE);
 #endif
-        if (nread != -1) {
+            if (nread == 0) {
+                connectionClosed = true;
+            }
+            if (nread <= 0) {
+                return;
+            }
             socketBufferStr.append(socketBuffer, nread);
-        }
-        if (this->currentControlMessage == "") {
-            ssize_t pos = socketBufferStr.find('\n');
-            if (pos > 0) {
-                std::string line = socketBufferStr.substr(0, pos);
-                if (line.length() > this->protocolString.length() + 1
-                    && line.substr(0, this->protocolString.length())
-                    == this->protocolString) {
-                    this->currentControlMessage = line.substr(
-                        this->protocolString.length() + 1,
-                        line.length() - (this->protocolString.length() + 1));
-                    socketBufferStr = socketBufferStr.substr(pos + 1,
-                        socketBufferStr.length() - (pos + 1));
-                }
-                else {
-                    std::cerr << "Protocol mismatch with server" << std::endl;
-                    exit(EXIT_FAILURE);
-                }
+            if (nread < BUF_SIZE) {
+                return;
             }
         }
+    }
 
-        return this->currentControlMessage;
+    /**
+     * Takes the next complete line from socketBufferStr, without the
+     * protocol prefix, as a span into the buffer. Consumed lines are only
+     * cut off the buffer once it holds no complete line, so a burst is
+     * taken apart in linear time, and the spans taken stay valid until
+     * this returns false or the socket is read again.
+     * @return false if no complete line is buffered
+     */
+    bool DRDTChallengeClient::takeControlMessage(TextSpan &message) {
+        size_t pos = socketBufferStr.find('\n', socketBufferPos);
+        if (pos == std::string::npos) {
+            socketBufferStr.erase(0, socketBufferPos);
+            socketBufferPos = 0;
+            return false;
+        }
+        size_t length = pos - socketBufferPos;
+        size_t prefix = this->protocolString.length();
+        if (length <= prefix + 1
+            || socketBufferStr.compare(socketBufferPos, prefix,
+                this->protocolString) != 0) {
+            std::cerr << "Protocol mismatch with server" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        message = TextSpan(socketBufferStr.data() + socketBufferPos + prefix + 1,
+            length - (prefix + 1));
+        socketBufferPos = pos + 1;
+        return true;
     }
 
     void DRDTChallengeClient::clearControlMessage() {
         this->currentControlMessage = "";
     }
 
+    /**
+     * Any thread. Queues message and writes out as much of the send buffer
+     * as the socket takes now; the event loop writes the rest.
+     */
     void DRDTChallengeClient::sendControlMessage(std::string message) {
-        std::string controlMessage = this->protocolString + " " + message + "\n";
-#ifdef _MSC_VER
-        ssize_t nwritten = send(sock, controlMessage.c_str(), controlMessage.length(), 0);
-#else
-        ssize_t nwritten = write(sock, controlMessage.c_str(), controlMessage.length());
-#endif
-        if (nwritten != (ssize_t)controlMessage.length()) {
-            std::cerr << "Write failed" << std::endl;
-            exit(EXIT_FAILURE);
+        bool flushed;
+        {
+            std::lock_guard<std::mutex> guard(sendBufferLock);
+            appendControlMessage(message);
+            flushed = flushSendBuffer();
         }
+        if (!flushed)
+            wakeEventLoop();
     }
 
-    std::vector<std::string> &DRDTChallengeClient::split(const std::string &s,
-        char delim, std::vector<std::string> &elems) {
-        std::stringstream ss(s);
-        std::string item;
-        while (std::getline(ss, item, delim)) {
-            elems.push_back(item);
-        }
-        return elems;
+    /**
+     * Caller holds sendBufferLock.
+     */
+    void DRDTChallengeClient::appendControlMessage(const std::string &message) {
+        sendBuffer.append(this->protocolString);
+        sendBuffer.push_back(' ');
+        sendBuffer.append(message);
+        sendBuffer.push_back('\n');
     }
 
-    std::vector<std::string> DRDTChallengeClient::split(const std::string &s,
-        char delim) {
-        std::vector<std::string> elems;
-        split(s, delim, elems);
-        return elems;
+    /**
+     * Caller holds sendBufferLock. Queues a TRANSMIT of packet, encoded
+     * straight into the send buffer.
+     */
+    void DRDTChallengeClient::appendTransmit(const Packet &packet) {
+        packetsSent.add();
+        trace(TRACE_CLIENT_TRANSMIT, (uint32_t)sendBuffer.size(), (uint32_t)packet.size());
+        sendBuffer.append(this->protocolString);
+        sendBuffer.append(" TRANSMIT ");
+        size_t start = sendBuffer.size();
+        sendBuffer.resize(start + base64_encoded_length(packet.size()));
+        base64_encode(packet.data(), packet.size(), &sendBuffer[0] + start);
+        sendBuffer.push_back('\n');
+    }
+
+    /**
+     * Caller holds sendBufferLock. Writes until the buffer is empty or the
+     * socket would block.
+     * @return whether the buffer is empty
+     */
+    bool DRDTChallengeClient::flushSendBuffer() {
+        size_t written = 0;
+        while (written < sendBuffer.size()) {
+#ifdef _MSC_VER
+            ssize_t nwritten = send(sock, sendBuffer.data() + written,
+                (int)(sendBuffer.size() - written), 0);
+            bool wouldBlock = nwritten == -1
+                && WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+            ssize_t nwritten = write(sock, sendBuffer.data() + written,
+                sendBuffer.size() - written);
+            bool wouldBlock = nwritten == -1
+                && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+#endif
+            if (nwritten > 0) {
+                written += nwritten;
+            }
+            else if (wouldBlock) {
+                break;
+            }
+            else {
+                std::cerr << "Write failed" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+        sendBuffer.erase(0, written);
+        return sendBuffer.empty();
     }
 } /* namespace framework */
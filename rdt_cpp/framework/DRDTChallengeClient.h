@@ -29,22 +29,35 @@ using ssize_t = ptrdiff_t;
 #include <unistd.h>
 #endif
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <atomic>
 #include <cstdint>
 #include <string.h>
 #include <sstream>
 #include <iostream>
 #include <fcntl.h>
 #include <thread>
-#include <list>
+#include <deque>
 #include <vector>
 #include <mutex>
+#include <errno.h>
 #include <fstream>
 #include <math.h>
 #include "base64.h"
 #include "crc32.h"
+#include "SpscRing.h"
+#include "ControlLine.h"
+#include "Packet.h"
+#include "Metrics.h"
+#include "Trace.h"
 #include <algorithm>
+#include <chrono>
 
 #ifndef DRDTCLIENT_DRDTCHALLENGECLIENT_H_
 #define DRDTCLIENT_DRDTCHALLENGECLIENT_H_
@@ -65,9 +78,12 @@ namespace framework {
         bool isSimulationStarted();
         bool isSimulationFinished();
         bool isOutputBufferEmpty();
-        bool receivePacket(std::vector<int32_t> *packet);
+        bool receivePacket(Packet *packet);
+        size_t receivePackets(std::vector<Packet> *packets);
         void sendChecksum(std::string, std::string);
-        void sendPacket(std::vector<int32_t> packet);
+        void sendChecksum(std::string type, const std::vector<int32_t> &contents);
+        void sendPacket(Packet packet);
+        void sendPackets(std::vector<Packet> *packets);
         void stop();
         std::string getFileID();
         std::thread * getEventLoop();
@@ -80,25 +96,76 @@ namespace framework {
         std::string groupKey;
         std::string fileID;
         std::string currentControlMessage = "";
-        bool simulationStarted = false;
-        bool simulationFinished = false;
+        // Read by the protocol thread while the event loop may change them.
+        std::atomic<bool> simulationStarted{false};
+        std::atomic<bool> simulationFinished{false};
         bool isSender = false;
         std::string challenge;
         std::string socketBufferStr;
+        size_t socketBufferPos = 0; // start of the first line not yet taken
         std::thread eventLoopThread;
-        std::list<std::vector<int32_t>> inputPacketBuffer;
-        std::mutex inputPacketBufferLock;
-        std::list<std::vector<int32_t>> outputPacketBuffer;
-        std::mutex outputPacketBufferLock;
+        // Packets between the event loop and the protocol thread: the event
+        // loop alone pushes input and pops output, the protocol thread alone
+        // does the opposite. Input that finds the ring full waits in
+        // inputBacklog, which only the event loop touches; a protocol that
+        // finds the output ring full waits for the event loop to drain it.
+        static const size_t PACKET_RING_SLOTS = 4096;
+        SpscRing<Packet> inputPacketRing;
+        SpscRing<Packet> outputPacketRing;
+        std::deque<Packet> inputBacklog;
+        Packet inboundPacket; // decode buffer, event loop only
+
+        // The event loop blocks in epoll on the socket and on wakeFd, which
+        // senders signal when they queue output while it is asleep. Where
+        // there is no epoll it polls every millisecond instead.
+        int epollFd = -1;
+        int wakeFd = -1;
+        std::atomic<bool> loopSleeping{false};
+        bool connectionClosed = false;
+
+        // Control messages not yet taken by the non-blocking socket. The
+        // event loop encodes all queued output into it at once, up to
+        // SEND_BUFFER_LIMIT, and waits for the socket to become writable
+        // when it is full; other threads only append their rare messages.
+        static const size_t SEND_BUFFER_LIMIT = 65536;
+        std::string sendBuffer;
+        std::mutex sendBufferLock;
+        bool writeWatched = false;
+
+        // Files are checksummed a chunk at a time, so the memory a checksum
+        // takes does not grow with the file.
+        static const size_t CHECKSUM_CHUNK_BYTES = 65536;
+
+        // Session metrics, looked up once in the constructor. The phases are
+        // waiting for START and the simulation itself, timed by the event
+        // loop from phaseStart.
+        Counter &packetsSent;
+        Counter &packetsReceived;
+        Counter &inputBacklogged;
+        Gauge &inputQueueDepth;
+        Gauge &outputQueueDepth;
+        Counter &waitStartTime;
+        Counter &simulationTime;
+        Counter &checksumTime;
+        std::chrono::steady_clock::time_point phaseStart;
 
         void clientConnect();
         std::string getControlMessageBlocking();
         std::string getControlMessage();
         void clearControlMessage();
+        void endPhase(Counter &phaseTime);
+        void queueInputPacket(Packet &packet);
+        void setupEventLoop();
+        void waitForWork(int timeoutMs);
+        void wakeEventLoop();
+        bool hasBufferedLine();
+        void readSocket();
+        bool takeControlMessage(TextSpan &message);
         void sendControlMessage(std::string message);
-        std::vector<std::string> &split(const std::string &s, char delim,
-            std::vector<std::string> &elems);
-        std::vector<std::string> split(const std::string &s, char delim);
+        void appendControlMessage(const std::string &message);
+        void appendTransmit(const Packet &packet);
+        bool flushSendBuffer();
+        void watchWritable(bool watch);
     };
 
 } /* namespace framework */
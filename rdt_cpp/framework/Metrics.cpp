@@ -0,0 +1,278 @@
+/**
+ * Metrics.cpp
+ */
+
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace framework {
+
+    namespace {
+
+        /**
+         * @return this thread's shard, handed out round robin on first use
+         */
+        size_t threadShard(size_t shards) {
+            static std::atomic<size_t> nextThread(0);
+            static thread_local size_t thread =
+                nextThread.fetch_add(1, std::memory_order_relaxed);
+            return thread % shards;
+        }
+
+        void raiseTo(std::atomic<uint64_t> &max, uint64_t value) {
+            uint64_t seen = max.load(std::memory_order_relaxed);
+            while (value > seen
+                && !max.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+            }
+        }
+
+        void raiseTo(std::atomic<int64_t> &max, int64_t value) {
+            int64_t seen = max.load(std::memory_order_relaxed);
+            while (value > seen
+                && !max.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+            }
+        }
+
+        size_t bucketOf(uint64_t value) {
+            size_t bucket = 0;
+            while (value != 0) {
+                bucket++;
+                value >>= 1;
+            }
+            return bucket;
+        }
+
+        std::string quoted(const std::string &text) {
+            std::string out = "\"";
+            for (char c : text) {
+                if (c == '"' || c == '\\') {
+                    out += '\\';
+                    out += c;
+                } else if ((unsigned char)c < 0x20) {
+                    char escape[8];
+                    snprintf(escape, sizeof(escape), "\\u%04x", c);
+                    out += escape;
+                } else {
+                    out += c;
+                }
+            }
+            return out + "\"";
+        }
+
+    } // namespace
+
+    Counter::Counter() {
+        for (Shard &shard : shards)
+            shard.value.store(0, std::memory_order_relaxed);
+    }
+
+    void Counter::add(uint64_t n) {
+        shards[threadShard(SHARDS)].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t Counter::get() const {
+        uint64_t total = 0;
+        for (const Shard &shard : shards)
+            total += shard.value.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    Gauge::Gauge() : value(0), max(0) {}
+
+    void Gauge::set(int64_t value) {
+        this->value.store(value, std::memory_order_relaxed);
+        raiseTo(max, value);
+    }
+
+    int64_t Gauge::get() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    int64_t Gauge::getMax() const {
+        return max.load(std::memory_order_relaxed);
+    }
+
+    Histogram::Histogram() {
+        for (Shard &shard : shards) {
+            shard.count.store(0, std::memory_order_relaxed);
+            shard.sum.store(0, std::memory_order_relaxed);
+            shard.max.store(0, std::memory_order_relaxed);
+            for (std::atomic<uint64_t> &bucket : shard.buckets)
+                bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void Histogram::record(uint64_t value) {
+        Shard &shard = shards[threadShard(SHARDS)];
+        shard.count.fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(value, std::memory_order_relaxed);
+        shard.buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        raiseTo(shard.max, value);
+    }
+
+    uint64_t Histogram::getCount() const {
+        uint64_t total = 0;
+        for (const Shard &shard : shards)
+            total += shard.count.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    uint64_t Histogram::getSum() const {
+        uint64_t total = 0;
+        for (const Shard &shard : shards)
+            total += shard.sum.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    uint64_t Histogram::getMax() const {
+        uint64_t max = 0;
+        for (const Shard &shard : shards)
+            max = std::max(max, shard.max.load(std::memory_order_relaxed));
+        return max;
+    }
+
+    /**
+     * @return the upper edge of the bucket holding the given fraction of
+     * samples, capped at the largest sample; 0 if there are none
+     */
+    uint64_t Histogram::getPercentile(double fraction) const {
+        uint64_t counts[BUCKETS] = {0};
+        uint64_t total = 0;
+        for (const Shard &shard : shards) {
+            for (size_t b = 0; b < BUCKETS; b++) {
+                uint64_t n = shard.buckets[b].load(std::memory_order_relaxed);
+                counts[b] += n;
+                total += n;
+            }
+        }
+        if (total == 0)
+            return 0;
+        uint64_t rank = (uint64_t)(fraction * (double)(total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t b = 0; b < BUCKETS; b++) {
+            seen += counts[b];
+            if (seen >= rank) {
+                uint64_t edge = b == 0 ? 0
+                    : b == BUCKETS - 1 ? UINT64_MAX : (UINT64_C(1) << b) - 1;
+                return std::min(edge, getMax());
+            }
+        }
+        return getMax();
+    }
+
+    PhaseTimer::PhaseTimer(Counter &counter)
+        : counter(counter), start(std::chrono::steady_clock::now()) {}
+
+    PhaseTimer::~PhaseTimer() {
+        counter.add((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+    MetricsRegistry &MetricsRegistry::shared() {
+        // Deliberately never destroyed; see the header.
+        static MetricsRegistry *registry = new MetricsRegistry();
+        return *registry;
+    }
+
+    Counter &MetricsRegistry::counter(const std::string &name) {
+        std::lock_guard<std::mutex> guard(lock);
+        std::unique_ptr<Counter> &metric = counters[name];
+        if (!metric)
+            metric.reset(new Counter());
+        return *metric;
+    }
+
+    Gauge &MetricsRegistry::gauge(const std::string &name) {
+        std::lock_guard<std::mutex> guard(lock);
+        std::unique_ptr<Gauge> &metric = gauges[name];
+        if (!metric)
+            metric.reset(new Gauge());
+        return *metric;
+    }
+
+    Histogram &MetricsRegistry::histogram(const std::string &name) {
+        std::lock_guard<std::mutex> guard(lock);
+        std::unique_ptr<Histogram> &metric = histograms[name];
+        if (!metric)
+            metric.reset(new Histogram());
+        return *metric;
+    }
+
+    void MetricsRegistry::setLabel(const std::string &name, const std::string &value) {
+        std::lock_guard<std::mutex> guard(lock);
+        labels[name] = value;
+    }
+
+    void MetricsRegistry::setValue(const std::string &name, double value) {
+        std::lock_guard<std::mutex> guard(lock);
+        values[name] = value;
+    }
+
+    /**
+     * One object per kind of metric, keyed by name, in name order.
+     */
+    std::string MetricsRegistry::toJson() {
+        std::lock_guard<std::mutex> guard(lock);
+        std::ostringstream out;
+        const char *separator;
+
+        out << "{\n  \"labels\": {";
+        separator = "";
+        for (const std::pair<const std::string, std::string> &label : labels) {
+            out << separator << "\n    " << quoted(label.first) << ": " << quoted(label.second);
+            separator = ",";
+        }
+
+        out << "\n  },\n  \"values\": {";
+        separator = "";
+        for (const std::pair<const std::string, double> &value : values) {
+            out << separator << "\n    " << quoted(value.first) << ": " << value.second;
+            separator = ",";
+        }
+
+        out << "\n  },\n  \"counters\": {";
+        separator = "";
+        for (const std::pair<const std::string, std::unique_ptr<Counter>> &counter : counters) {
+            out << separator << "\n    " << quoted(counter.first) << ": " << counter.second->get();
+            separator = ",";
+        }
+
+        out << "\n  },\n  \"gauges\": {";
+        separator = "";
+        for (const std::pair<const std::string, std::unique_ptr<Gauge>> &gauge : gauges) {
+            out << separator << "\n    " << quoted(gauge.first) << ": {\"value\": "
+                << gauge.second->get() << ", \"max\": " << gauge.second->getMax() << "}";
+            separator = ",";
+        }
+
+        out << "\n  },\n  \"histograms\": {";
+        separator = "";
+        for (const std::pair<const std::string, std::unique_ptr<Histogram>> &histogram : histograms) {
+            const Histogram &h = *histogram.second;
+            uint64_t count = h.getCount();
+            out << separator << "\n    " << quoted(histogram.first) << ": {\"count\": " << count
+                << ", \"mean\": " << (count > 0 ? (double)h.getSum() / count : 0.0)
+                << ", \"p50\": " << h.getPercentile(0.5)
+                << ", \"p90\": " << h.getPercentile(0.9)
+                << ", \"p99\": " << h.getPercentile(0.99)
+                << ", \"max\": " << h.getMax() << "}";
+            separator = ",";
+        }
+
+        out << "\n  }\n}\n";
+        return out.str();
+    }
+
+    bool MetricsRegistry::writeJson(const std::string &path) {
+        std::string json = toJson();
+        std::ofstream ofs(path, std::ofstream::binary | std::ofstream::trunc);
+        ofs.write(json.data(), json.size());
+        ofs.close();
+        return ofs.good();
+    }
+
+} /* namespace framework */
@@ -0,0 +1,149 @@
+/**
+ * Metrics.h
+ *
+ * Counters, gauges and histograms for one session, registered by name in
+ * a process-wide registry and written out as JSON when the session ends,
+ * so that a slow run can be explained afterwards.
+ *
+ * Counters and histograms are split into shards, one picked per thread,
+ * and updated with relaxed atomic adds: threads counting the same thing
+ * do not fight over a cache line, and readers sum the shards. Look a
+ * metric up once and keep the reference; the lookup takes a lock, the
+ * updates do not.
+ */
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace framework {
+
+    class Counter {
+    public:
+        Counter();
+        void add(uint64_t n = 1);
+        uint64_t get() const;
+
+    private:
+        static const size_t SHARDS = 8;
+        static const size_t CACHE_LINE = 64;
+
+        struct Shard {
+            std::atomic<uint64_t> value;
+            char padding[CACHE_LINE - sizeof(std::atomic<uint64_t>)];
+        };
+        Shard shards[SHARDS];
+    };
+
+    /**
+     * The latest value of something that goes up and down, such as a
+     * queue depth, and the highest it has been.
+     */
+    class Gauge {
+    public:
+        Gauge();
+        void set(int64_t value);
+        int64_t get() const;
+        int64_t getMax() const;
+
+    private:
+        std::atomic<int64_t> value;
+        std::atomic<int64_t> max;
+    };
+
+    /**
+     * Distribution of non-negative samples in power-of-two buckets: bucket
+     * 0 holds zeros, bucket b values in [2^(b-1), 2^b). Percentiles are
+     * read as the upper edge of their bucket, so they are within a factor
+     * of two.
+     */
+    class Histogram {
+    public:
+        static const size_t BUCKETS = 65;
+
+        Histogram();
+        void record(uint64_t value);
+        uint64_t getCount() const;
+        uint64_t getSum() const;
+        uint64_t getMax() const;
+        uint64_t getPercentile(double fraction) const;
+
+    private:
+        static const size_t SHARDS = 8;
+        static const size_t CACHE_LINE = 64;
+
+        struct Shard {
+            std::atomic<uint64_t> count;
+            std::atomic<uint64_t> sum;
+            std::atomic<uint64_t> max;
+            std::atomic<uint64_t> buckets[BUCKETS];
+            char padding[CACHE_LINE];
+        };
+        Shard shards[SHARDS];
+    };
+
+    /**
+     * Adds the microseconds between its construction and destruction to a
+     * counter, for the time spent in a phase.
+     */
+    class PhaseTimer {
+    public:
+        explicit PhaseTimer(Counter &counter);
+        ~PhaseTimer();
+
+    private:
+        Counter &counter;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    class MetricsRegistry {
+    public:
+        /**
+         * @return the registry shared by every thread; it is never destroyed,
+         * so metrics stay valid during exit too
+         */
+        static MetricsRegistry &shared();
+
+        /**
+         * @return the metric called name, created on first use; the
+         * reference stays valid for the life of the program
+         */
+        Counter &counter(const std::string &name);
+        Gauge &gauge(const std::string &name);
+        Histogram &histogram(const std::string &name);
+
+        /**
+         * Records a fact about the session, such as the file or the score.
+         */
+        void setLabel(const std::string &name, const std::string &value);
+        void setValue(const std::string &name, double value);
+
+        std::string toJson();
+
+        /**
+         * @return whether the JSON summary could be written to path
+         */
+        bool writeJson(const std::string &path);
+
+    private:
+        std::mutex lock;
+        std::map<std::string, std::unique_ptr<Counter>> counters;
+        std::map<std::string, std::unique_ptr<Gauge>> gauges;
+        std::map<std::string, std::unique_ptr<Histogram>> histograms;
+        std::map<std::string, std::string> labels;
+        std::map<std::string, double> values;
+
+        MetricsRegistry() {}
+    };
+
+} /* namespace framework */
+
+#endif /* METRICS_H_ */
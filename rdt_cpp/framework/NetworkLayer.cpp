@@ -25,12 +25,58 @@ namespace framework {
     NetworkLayer::~NetworkLayer() {
     }
 
+    void NetworkLayer::sendPacket(Packet packet) {
+        this->challengeClient->sendPacket(std::move(packet));
+    }
+
+    /**
+     * Sends a whole batch of packets in order, handing them over in one go.
+     * Leaves packets empty but with its capacity, ready to be refilled.
+     */
+    void NetworkLayer::sendPackets(std::vector<Packet> *packets) {
+        this->challengeClient->sendPackets(packets);
+    }
+
+    bool NetworkLayer::receivePacket(Packet *packet) {
+        return this->challengeClient->receivePacket(packet);
+    }
+
+    /**
+     * Appends all packets received so far to packets.
+     * @return the number of packets appended, 0 if none were waiting
+     */
+    size_t NetworkLayer::receivePackets(std::vector<Packet> *packets) {
+        return this->challengeClient->receivePackets(packets);
+    }
+
     void NetworkLayer::sendPacket(std::vector<int32_t> packet) {
-        this->challengeClient->sendPacket(packet);
+        sendPacket(toPacket(packet));
+    }
+
+    void NetworkLayer::sendPackets(std::vector<std::vector<int32_t>> packets) {
+        std::vector<Packet> converted;
+        converted.reserve(packets.size());
+        for (const std::vector<int32_t> &packet : packets) {
+            converted.push_back(toPacket(packet));
+        }
+        sendPackets(&converted);
     }
 
     bool NetworkLayer::receivePacket(std::vector<int32_t> *packet) {
-        return this->challengeClient->receivePacket(packet);
+        Packet received;
+        if (!receivePacket(&received))
+            return false;
+        *packet = toIntegers(received);
+        return true;
+    }
+
+    size_t NetworkLayer::receivePackets(std::vector<std::vector<int32_t>> *packets) {
+        std::vector<Packet> received;
+        size_t count = receivePackets(&received);
+        for (const Packet &packet : received) {
+            packets->push_back(toIntegers(packet));
+        }
+        return count;
     }
 
 } /* namespace framework */
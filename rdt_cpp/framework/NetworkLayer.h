@@ -20,8 +20,10 @@
 #include <sys/types.h>
 #include <stdlib.h>
 #include <cstdint>
+#include <utility>
 #include <vector>
 #include "DRDTChallengeClient.h"
+#include "Packet.h"
 
 namespace framework {
 
@@ -29,8 +31,15 @@ namespace framework {
     public:
         NetworkLayer(DRDTChallengeClient *drdtclient);
         virtual ~NetworkLayer();
+        virtual void sendPacket(Packet packet);
+        virtual void sendPackets(std::vector<Packet> *packets);
+        virtual bool receivePacket(Packet *packet);
+        virtual size_t receivePackets(std::vector<Packet> *packets);
+        // One byte per integer, converted to and from the calls above.
         void sendPacket(std::vector<int32_t> packet);
+        void sendPackets(std::vector<std::vector<int32_t>> packets);
         bool receivePacket(std::vector<int32_t> *packet);
+        size_t receivePackets(std::vector<std::vector<int32_t>> *packets);
     private:
         DRDTChallengeClient* challengeClient;
     };
@@ -0,0 +1,38 @@
+/**
+ * Packet.h
+ *
+ * The packet buffer handed between protocol, network layer and client: one
+ * byte per byte on the wire, stored in PacketPool slots so that building,
+ * copying and dropping packets does not touch the heap. The original
+ * interface, one byte per int32_t with only the lowest 8 bits used, is
+ * still accepted, through the conversions below.
+ */
+
+#ifndef PACKET_H_
+#define PACKET_H_
+
+#include <cstdint>
+#include <vector>
+#include "PacketPool.h"
+
+namespace framework {
+
+    typedef std::vector<uint8_t, PacketAllocator<uint8_t>> Packet;
+
+    /**
+     * @return the lowest 8 bits of every integer
+     */
+    inline Packet toPacket(const std::vector<int32_t> &integers) {
+        return Packet(integers.begin(), integers.end());
+    }
+
+    /**
+     * @return every byte as an integer in [0, 255]
+     */
+    inline std::vector<int32_t> toIntegers(const Packet &packet) {
+        return std::vector<int32_t>(packet.begin(), packet.end());
+    }
+
+} /* namespace framework */
+
+#endif /* PACKET_H_ */
@@ -0,0 +1,137 @@
+/**
+ * PacketPool.cpp
+ */
+
+#include "PacketPool.h"
+
+#include <new>
+
+namespace framework {
+
+    PacketPool::PacketPool() : returned(nullptr), slabCount(0) {}
+
+    PacketPool &PacketPool::shared() {
+        // Deliberately never destroyed; see the header.
+        static PacketPool *pool = new PacketPool();
+        return *pool;
+    }
+
+    PacketPool::ThreadCache &PacketPool::threadCache() {
+        static thread_local ThreadCache cache = {nullptr, nullptr, 0, false};
+        static thread_local CacheOwner owner;
+        return cache;
+    }
+
+    /**
+     * Returns the exiting thread's slots for other threads to take. Buffers
+     * the thread still frees afterwards go to the return stack one by one.
+     */
+    PacketPool::CacheOwner::~CacheOwner() {
+        ThreadCache &cache = threadCache();
+        if (cache.head != nullptr)
+            shared().pushReturned(cache.head, cache.tail, cache.length);
+        cache.head = nullptr;
+        cache.tail = nullptr;
+        cache.length = 0;
+        cache.exited = true;
+    }
+
+    void *PacketPool::allocate(size_t bytes) {
+        if (bytes > SLOT_BYTES)
+            return ::operator new(bytes);
+        ThreadCache &cache = threadCache();
+        if (cache.head == nullptr) {
+            takeReturned(cache);
+            if (cache.head == nullptr)
+                grow(cache);
+        }
+        FreeSlot *slot = cache.head;
+        cache.head = slot->next;
+        if (cache.head == nullptr)
+            cache.tail = nullptr;
+        cache.length--;
+        return slot;
+    }
+
+    void PacketPool::deallocate(void *slot, size_t bytes) {
+        if (bytes > SLOT_BYTES) {
+            ::operator delete(slot);
+            return;
+        }
+        FreeSlot *freed = static_cast<FreeSlot *>(slot);
+        ThreadCache &cache = threadCache();
+        if (cache.exited) {
+            freed->next = nullptr;
+            pushReturned(freed, freed, 1);
+            return;
+        }
+        freed->next = cache.head;
+        if (cache.head == nullptr)
+            cache.tail = freed;
+        cache.head = freed;
+        if (++cache.length < 2 * BATCH_SLOTS)
+            return;
+
+        // Keep the BATCH_SLOTS freed last, still warm, and return the rest.
+        FreeSlot *keep = cache.head;
+        for (size_t i = 1; i < BATCH_SLOTS; i++)
+            keep = keep->next;
+        FreeSlot *first = keep->next;
+        keep->next = nullptr;
+        pushReturned(first, cache.tail, cache.length - BATCH_SLOTS);
+        cache.tail = keep;
+        cache.length = BATCH_SLOTS;
+    }
+
+    size_t PacketPool::getSlabCount() {
+        return slabCount.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Only ever pushed to and emptied whole, never popped from, so a push
+     * racing a take cannot link a batch that was taken meanwhile.
+     */
+    void PacketPool::pushReturned(FreeSlot *first, FreeSlot *last, size_t length) {
+        first->last = last;
+        first->length = length;
+        FreeSlot *head = returned.load(std::memory_order_relaxed);
+        do {
+            first->nextBatch = head;
+        } while (!returned.compare_exchange_weak(head, first,
+            std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /**
+     * Moves every returned batch onto the cache's free list.
+     */
+    void PacketPool::takeReturned(ThreadCache &cache) {
+        FreeSlot *batch = returned.exchange(nullptr, std::memory_order_acquire);
+        while (batch != nullptr) {
+            FreeSlot *nextBatch = batch->nextBatch;
+            batch->last->next = cache.head;
+            if (cache.head == nullptr)
+                cache.tail = batch->last;
+            cache.head = batch;
+            cache.length += batch->length;
+            batch = nextBatch;
+        }
+    }
+
+    /**
+     * Threads a new slab's slots onto the cache's free list.
+     */
+    void PacketPool::grow(ThreadCache &cache) {
+        char *slab = static_cast<char *>(
+            ::operator new(SLOT_BYTES * SLOTS_PER_SLAB));
+        for (size_t i = SLOTS_PER_SLAB; i-- > 0;) {
+            FreeSlot *slot = reinterpret_cast<FreeSlot *>(slab + i * SLOT_BYTES);
+            slot->next = cache.head;
+            if (cache.head == nullptr)
+                cache.tail = slot;
+            cache.head = slot;
+        }
+        cache.length += SLOTS_PER_SLAB;
+        slabCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+} /* namespace framework */
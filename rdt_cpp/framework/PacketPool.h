@@ -0,0 +1,115 @@
+/**
+ * PacketPool.h
+ *
+ * Recycled storage for packet buffers. Requests of up to SLOT_BYTES are
+ * served from slabs carved into fixed-size slots; a released slot goes on
+ * a free list and is handed out again. Slabs are never given back, so once
+ * the pool has grown to the number of packets alive at a time, packets
+ * cost no heap allocation however many pass. Bigger requests fall through
+ * to operator new.
+ *
+ * Each thread keeps its own free list, so allocating and freeing take no
+ * lock. Packets are mostly built on one thread and dropped on another, so
+ * a thread that frees more than it allocates passes batches of
+ * BATCH_SLOTS slots to a lock-free return stack, where a thread that has
+ * run dry takes them all back in one exchange.
+ *
+ * PacketAllocator plugs the pool into a standard container, so a buffer
+ * returns its slot whenever it is freed, on whichever thread.
+ */
+
+#ifndef PACKETPOOL_H_
+#define PACKETPOOL_H_
+
+#include <atomic>
+#include <cstddef>
+
+namespace framework {
+
+    class PacketPool {
+    public:
+        static const size_t SLOT_BYTES = 256;
+        static const size_t SLOTS_PER_SLAB = 512;
+
+        /**
+         * @return the pool shared by every thread; it outlives all static
+         * objects, so buffers may be freed during exit too
+         */
+        static PacketPool &shared();
+
+        void *allocate(size_t bytes);
+        void deallocate(void *slot, size_t bytes);
+
+        /**
+         * @return the number of slabs taken from the heap so far
+         */
+        size_t getSlabCount();
+
+    private:
+        static const size_t BATCH_SLOTS = 64;
+
+        // A free slot. The first slot of a batch on the return stack also
+        // links to the next batch and knows its own last slot and length.
+        struct FreeSlot {
+            FreeSlot *next;
+            FreeSlot *nextBatch;
+            FreeSlot *last;
+            size_t length;
+        };
+
+        // One thread's free list. Plain data, so that it is still usable
+        // when its thread frees buffers after its destructors have run.
+        struct ThreadCache {
+            FreeSlot *head;
+            FreeSlot *tail;
+            size_t length;
+            bool exited;
+        };
+
+        // Hands a thread's free list on when the thread exits.
+        struct CacheOwner {
+            ~CacheOwner();
+        };
+
+        std::atomic<FreeSlot *> returned;
+        std::atomic<size_t> slabCount;
+
+        PacketPool();
+        static ThreadCache &threadCache();
+        void pushReturned(FreeSlot *first, FreeSlot *last, size_t length);
+        void takeReturned(ThreadCache &cache);
+        void grow(ThreadCache &cache);
+    };
+
+    template <class T>
+    class PacketAllocator {
+    public:
+        typedef T value_type;
+
+        PacketAllocator() {}
+
+        template <class U>
+        PacketAllocator(const PacketAllocator<U> &) {}
+
+        T *allocate(size_t n) {
+            return static_cast<T *>(PacketPool::shared().allocate(n * sizeof(T)));
+        }
+
+        void deallocate(T *p, size_t n) {
+            PacketPool::shared().deallocate(p, n * sizeof(T));
+        }
+    };
+
+    template <class T, class U>
+    bool operator==(const PacketAllocator<T> &, const PacketAllocator<U> &) {
+        return true;
+    }
+
+    template <class T, class U>
+    bool operator!=(const PacketAllocator<T> &, const PacketAllocator<U> &) {
+        return false;
+    }
+
+} /* namespace framework */
+
+#endif /* PACKETPOOL_H_ */
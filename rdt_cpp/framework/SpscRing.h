@@ -0,0 +1,169 @@
+/**
+ * SpscRing.h
+ *
+ * Bounded single-producer/single-consumer queue of preallocated slots.
+ * Exactly one thread may push and one other thread may pop, without locks:
+ * each index is only written by its own side, and is published with
+ * release ordering after the slot it hands over, so the other side's
+ * acquire load sees the slot's contents complete.
+ */
+
+#ifndef SPSCRING_H_
+#define SPSCRING_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace framework {
+
+    template <class T>
+    class SpscRing {
+    public:
+        /**
+         * @param capacity number of slots, rounded up to a power of two
+         */
+        explicit SpscRing(size_t capacity);
+
+        /**
+         * Producer only. Calls fill(slot) on the next free slot, then
+         * publishes it. Slots keep their storage, so filling one by assign
+         * or swap costs no allocation once it has held a similar item.
+         * @return false, without calling fill, if the ring is full
+         */
+        template <class Fill>
+        bool tryPush(Fill fill);
+
+        /**
+         * Consumer only. Calls take(slot) on the oldest slot, then frees it.
+         * @return false, without calling take, if the ring is empty
+         */
+        template <class Take>
+        bool tryPop(Take take);
+
+        /**
+         * Producer only. Calls fill(slot, i) for i from 0 on the next free
+         * slots, up to count of them, then publishes them all at once.
+         * @return how many slots were filled, 0 if the ring is full
+         */
+        template <class Fill>
+        size_t tryPushMany(size_t count, Fill fill);
+
+        /**
+         * Consumer only. Calls take(slot) on every queued slot, oldest
+         * first, then frees them all at once.
+         * @return how many slots were taken
+         */
+        template <class Take>
+        size_t tryPopAll(Take take);
+
+        /**
+         * @return whether nothing is queued; exact for the consumer, a
+         * snapshot for anyone else
+         */
+        bool empty() const;
+
+        /**
+         * @return how many items are queued; a snapshot for either thread
+         */
+        size_t size() const;
+
+    private:
+        static const size_t CACHE_LINE = 64;
+
+        std::vector<T> slots;
+        size_t mask;
+
+        // Each side's index shares a cache line only with that side's copy
+        // of the other index, refreshed just when the ring looks full or
+        // empty, so the two threads rarely touch the same line.
+        char padding0[CACHE_LINE];
+        std::atomic<size_t> head; // next slot to pop, written by the consumer
+        size_t cachedTail;
+        char padding1[CACHE_LINE];
+        std::atomic<size_t> tail; // next slot to push, written by the producer
+        size_t cachedHead;
+        char padding2[CACHE_LINE];
+    };
+
+    template <class T>
+    SpscRing<T>::SpscRing(size_t capacity)
+        : head(0), cachedTail(0), tail(0), cachedHead(0) {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    template <class T>
+    template <class Fill>
+    bool SpscRing<T>::tryPush(Fill fill) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead == slots.size()) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead == slots.size())
+                return false;
+        }
+        fill(slots[t & mask]);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <class T>
+    template <class Take>
+    bool SpscRing<T>::tryPop(Take take) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail)
+                return false;
+        }
+        take(slots[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <class T>
+    template <class Fill>
+    size_t SpscRing<T>::tryPushMany(size_t count, Fill fill) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (slots.size() - (t - cachedHead) < count)
+            cachedHead = head.load(std::memory_order_acquire);
+        size_t n = std::min(count, slots.size() - (t - cachedHead));
+        for (size_t i = 0; i < n; i++)
+            fill(slots[(t + i) & mask], i);
+        if (n != 0)
+            tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+
+    template <class T>
+    template <class Take>
+    size_t SpscRing<T>::tryPopAll(Take take) {
+        size_t h = head.load(std::memory_order_relaxed);
+        cachedTail = tail.load(std::memory_order_acquire);
+        size_t n = cachedTail - h;
+        for (size_t i = 0; i < n; i++)
+            take(slots[(h + i) & mask]);
+        if (n != 0)
+            head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    template <class T>
+    bool SpscRing<T>::empty() const {
+        return head.load(std::memory_order_acquire) ==
+               tail.load(std::memory_order_acquire);
+    }
+
+    template <class T>
+    size_t SpscRing<T>::size() const {
+        size_t h = head.load(std::memory_order_acquire);
+        return tail.load(std::memory_order_acquire) - h;
+    }
+
+} /* namespace framework */
+
+#endif /* SPSCRING_H_ */
@@ -0,0 +1,195 @@
+/**
+ * Trace.cpp
+ */
+
+#include "Trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+namespace framework {
+
+    namespace {
+
+        // File layout, all little-endian: the magic, a uint32 version, the
+        // uint64 start time since the Unix epoch in ns and a uint64 event
+        // count, then per event timeNs (8), seq (4), value (4), type (1),
+        // thread (1) and 2 bytes of padding.
+        const char TRACE_MAGIC[8] = {'R', 'D', 'T', 'T', 'R', 'A', 'C', 'E'};
+        const uint32_t TRACE_VERSION = 1;
+        const size_t RECORD_BYTES = 20;
+        const uint64_t TIME_MASK = (UINT64_C(1) << 48) - 1;
+
+        int64_t steadyNs() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        uint8_t threadNumber() {
+            static std::atomic<uint32_t> nextThread(0);
+            static thread_local uint8_t thread =
+                (uint8_t)nextThread.fetch_add(1, std::memory_order_relaxed);
+            return thread;
+        }
+
+        void putLe(std::vector<char> &out, uint64_t value, size_t bytes) {
+            for (size_t i = 0; i < bytes; i++)
+                out.push_back((char)(value >> (8 * i)));
+        }
+
+        uint64_t getLe(const char *in, size_t bytes) {
+            uint64_t value = 0;
+            for (size_t i = 0; i < bytes; i++)
+                value |= (uint64_t)(uint8_t)in[i] << (8 * i);
+            return value;
+        }
+
+    } // namespace
+
+    TraceRing::Shard::Shard() : next(0), slots(SHARD_CAPACITY) {
+        for (Slot &slot : slots) {
+            slot.stamp.store(0, std::memory_order_relaxed);
+            slot.time.store(0, std::memory_order_relaxed);
+            slot.subject.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    TraceRing::TraceRing()
+        : enabled(true), startSteadyNs(steadyNs()),
+          startUnixNs((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::system_clock::now().time_since_epoch()).count()) {
+        for (std::atomic<Shard *> &shard : shards)
+            shard.store(nullptr, std::memory_order_relaxed);
+    }
+
+    TraceRing &TraceRing::shared() {
+        // Deliberately never destroyed; see the header.
+        static TraceRing *ring = new TraceRing();
+        return *ring;
+    }
+
+    void TraceRing::setEnabled(bool enabled) {
+        this->enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    TraceRing::Shard &TraceRing::shardFor(uint8_t thread) {
+        std::atomic<Shard *> &entry = shards[thread % SHARDS];
+        Shard *shard = entry.load(std::memory_order_acquire);
+        if (shard == nullptr) {
+            // Threads sharing the entry may race to create it; one wins.
+            Shard *created = new Shard();
+            if (entry.compare_exchange_strong(shard, created, std::memory_order_acq_rel))
+                shard = created;
+            else
+                delete created;
+        }
+        return *shard;
+    }
+
+    void TraceRing::record(TraceEventType type, uint32_t seq, uint32_t value) {
+        if (!enabled.load(std::memory_order_relaxed))
+            return;
+        uint64_t timeNs = (uint64_t)(steadyNs() - startSteadyNs) & TIME_MASK;
+        uint8_t thread = threadNumber();
+        Shard &shard = shardFor(thread);
+        uint64_t index = shard.next.fetch_add(1, std::memory_order_relaxed);
+        Slot &slot = shard.slots[index & (SHARD_CAPACITY - 1)];
+
+        slot.stamp.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.time.store(timeNs | (uint64_t)(uint8_t)type << 48
+            | (uint64_t)thread << 56, std::memory_order_relaxed);
+        slot.subject.store(seq | (uint64_t)value << 32, std::memory_order_relaxed);
+        slot.stamp.store(index + 1, std::memory_order_release);
+    }
+
+    /**
+     * Each slot is read between two loads of its stamp, and kept only if
+     * both name the event expected there.
+     */
+    std::vector<TraceEvent> TraceRing::snapshot() const {
+        std::vector<TraceEvent> events;
+        for (const std::atomic<Shard *> &entry : shards) {
+            const Shard *shard = entry.load(std::memory_order_acquire);
+            if (shard == nullptr)
+                continue;
+            uint64_t end = shard->next.load(std::memory_order_acquire);
+            uint64_t begin = end > SHARD_CAPACITY ? end - SHARD_CAPACITY : 0;
+            for (uint64_t index = begin; index < end; index++) {
+                const Slot &slot = shard->slots[index & (SHARD_CAPACITY - 1)];
+                if (slot.stamp.load(std::memory_order_acquire) != index + 1)
+                    continue;
+                uint64_t time = slot.time.load(std::memory_order_relaxed);
+                uint64_t subject = slot.subject.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.stamp.load(std::memory_order_relaxed) != index + 1)
+                    continue;
+
+                TraceEvent event;
+                event.timeNs = time & TIME_MASK;
+                event.type = (uint8_t)(time >> 48);
+                event.thread = (uint8_t)(time >> 56);
+                event.seq = (uint32_t)subject;
+                event.value = (uint32_t)(subject >> 32);
+                events.push_back(event);
+            }
+        }
+        std::stable_sort(events.begin(), events.end(),
+            [](const TraceEvent &a, const TraceEvent &b) {
+                return a.timeNs < b.timeNs;
+            });
+        return events;
+    }
+
+    bool TraceRing::writeFile(const std::string &path) const {
+        std::vector<TraceEvent> events = snapshot();
+        std::vector<char> out(TRACE_MAGIC, TRACE_MAGIC + sizeof(TRACE_MAGIC));
+        out.reserve(out.size() + 20 + events.size() * RECORD_BYTES);
+        putLe(out, TRACE_VERSION, 4);
+        putLe(out, startUnixNs, 8);
+        putLe(out, events.size(), 8);
+        for (const TraceEvent &event : events) {
+            putLe(out, event.timeNs, 8);
+            putLe(out, event.seq, 4);
+            putLe(out, event.value, 4);
+            putLe(out, event.type, 1);
+            putLe(out, event.thread, 1);
+            putLe(out, 0, 2);
+        }
+
+        std::ofstream ofs(path, std::ofstream::binary | std::ofstream::trunc);
+        ofs.write(out.data(), out.size());
+        ofs.close();
+        return ofs.good();
+    }
+
+    bool TraceRing::readFile(const std::string &path,
+        std::vector<TraceEvent> &events, uint64_t &startUnixNs) {
+        std::ifstream ifs(path, std::ifstream::binary);
+        char header[sizeof(TRACE_MAGIC) + 20];
+        if (!ifs.read(header, sizeof(header))
+            || memcmp(header, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0
+            || getLe(header + 8, 4) != TRACE_VERSION)
+            return false;
+        startUnixNs = getLe(header + 12, 8);
+        uint64_t count = getLe(header + 20, 8);
+
+        events.clear();
+        char record[RECORD_BYTES];
+        for (uint64_t i = 0; i < count; i++) {
+            if (!ifs.read(record, sizeof(record)))
+                return false;
+            TraceEvent event;
+            event.timeNs = getLe(record, 8);
+            event.seq = (uint32_t)getLe(record + 8, 4);
+            event.value = (uint32_t)getLe(record + 12, 4);
+            event.type = (uint8_t)record[16];
+            event.thread = (uint8_t)record[17];
+            events.push_back(event);
+        }
+        return true;
+    }
+
+} /* namespace framework */
@@ -0,0 +1,130 @@
+/**
+ * Trace.h
+ *
+ * Flight recorder of per-packet events: what was sent, resent, lost and
+ * acknowledged, and the window, each stamped to the nanosecond. Each thread
+ * records into its own fixed ring, which keeps its newest
+ * TraceRing::SHARD_CAPACITY events, and the rings are merged and written
+ * out in binary at the end of a session; tools/TraceQlog turns that file
+ * into qlog JSON for plotting sequence numbers against time.
+ *
+ * Recording takes no lock and, after a thread's first event, allocates
+ * nothing: the writer claims a slot in a ring no other thread normally
+ * writes and publishes it with a release store, cheap enough to leave on.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace framework {
+
+    /**
+     * What happened. The meaning of an event's seq and value depends on
+     * its type; sender and receiver events are in segments.
+     */
+    enum TraceEventType {
+        TRACE_PACKET_SENT = 1,      // seq sent for the first time, value cwnd or 0 if unwindowed
+        TRACE_RETRANSMIT = 2,       // seq sent again, value cwnd
+        TRACE_PACKET_LOST = 3,      // seq declared lost by reordering, value cwnd
+        TRACE_TIMEOUT = 4,          // seq declared lost by its RTO, value the RTO in ms
+        TRACE_ACK_RECEIVED = 5,     // seq the ack base, value the advertised window
+        TRACE_SACK_GAP = 6,         // seq the first hole, value the holes below the highest SACK
+        TRACE_WINDOW = 7,           // seq segments in flight, value the new cwnd
+        TRACE_DATA_RECEIVED = 8,    // seq received intact, value its payload bytes
+        TRACE_DUPLICATE = 9,        // seq received again
+        TRACE_ACK_SENT = 10,        // seq the ack base, value the advertised window
+        TRACE_CLIENT_TRANSMIT = 11, // seq bytes queued for the socket, value packet bytes
+        TRACE_CLIENT_PACKET = 12    // seq packets queued for the protocol, value packet bytes
+    };
+
+    struct TraceEvent {
+        uint64_t timeNs; // since the trace started
+        uint32_t seq;
+        uint32_t value;
+        uint8_t type;    // a TraceEventType
+        uint8_t thread;  // small per-thread number, in order of first use
+    };
+
+    class TraceRing {
+    public:
+        static const size_t SHARDS = 8; // threads past this share rings
+        static const size_t SHARD_CAPACITY = 1 << 15;
+
+        /**
+         * @return the ring every thread records into; it is never
+         * destroyed, so recording stays safe during exit
+         */
+        static TraceRing &shared();
+
+        /**
+         * Recording is on unless switched off; while off, record costs one
+         * relaxed load.
+         */
+        void setEnabled(bool enabled);
+
+        void record(TraceEventType type, uint32_t seq, uint32_t value);
+
+        /**
+         * @return the events still held, in time order. Events being
+         * written meanwhile are left out, so this is safe while recording
+         * goes on.
+         */
+        std::vector<TraceEvent> snapshot() const;
+
+        /**
+         * Writes snapshot() in the binary trace format read by readFile.
+         * @return whether the file could be written
+         */
+        bool writeFile(const std::string &path) const;
+
+        /**
+         * @param startUnixNs set to when the trace started, in nanoseconds
+         * since the Unix epoch
+         * @return whether path held a trace of a format this build reads
+         */
+        static bool readFile(const std::string &path,
+            std::vector<TraceEvent> &events, uint64_t &startUnixNs);
+
+    private:
+        // A slot's stamp is its event's index plus one once the event is
+        // complete, and 0 while it is written; fields are atomics so that
+        // a snapshot racing a writer reads a stale slot, never a torn one.
+        struct Slot {
+            std::atomic<uint64_t> stamp;
+            std::atomic<uint64_t> time;   // timeNs, type << 48, thread << 56
+            std::atomic<uint64_t> subject; // seq, value << 32
+        };
+
+        // Created by the first thread to record into it. next is only
+        // contended when more than SHARDS threads record.
+        struct Shard {
+            std::atomic<uint64_t> next;
+            std::vector<Slot> slots;
+            Shard();
+        };
+
+        std::atomic<Shard *> shards[SHARDS];
+        std::atomic<bool> enabled;
+        int64_t startSteadyNs;
+        uint64_t startUnixNs;
+
+        TraceRing();
+        Shard &shardFor(uint8_t thread);
+    };
+
+    /**
+     * Records an event in the shared ring.
+     */
+    inline void trace(TraceEventType type, uint32_t seq, uint32_t value) {
+        TraceRing::shared().record(type, seq, value);
+    }
+
+} /* namespace framework */
+
+#endif /* TRACE_H_ */
@@ -9,97 +9,248 @@
 
 #include "base64.h"
 
-static const std::string base64_chars =
+#include <cstring>
+
+// x86 builds get SSSE3 paths that take 16 characters per step, chosen at
+// run time so the binary still runs on processors without SSSE3.
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define BASE64_SSSE3
+#define BASE64_SSSE3_TARGET
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BASE64_SSSE3
+#define BASE64_SSSE3_TARGET __attribute__((target("ssse3")))
+#endif
+
+#ifdef BASE64_SSSE3
+#include <tmmintrin.h>
+#endif
+
+static const char base64_chars[] =
 "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
 "abcdefghijklmnopqrstuvwxyz"
 "0123456789+/";
 
+static const uint8_t BASE64_INVALID = 0xFF;
 
-static inline bool is_base64(unsigned char c) {
-    return (isalnum(c) || (c == '+') || (c == '/'));
-}
+// Reverse of base64_chars: the 6-bit value of each character, or
+// BASE64_INVALID for '=' and everything else outside the alphabet.
+struct Base64DecodeTable {
+    uint8_t values[256];
 
-// Note: only the lowest 8 bits of each integer is used.
-std::string base64_encode(std::vector<int32_t> const& data) {
-    std::string ret;
-    int i = 0;
-    int j = 0;
-    unsigned char char_array_3[3];
-    unsigned char char_array_4[4];
-
-    for (auto integer_to_encode : data) {
-        char_array_3[i++] = static_cast<unsigned char>(integer_to_encode & 0xff);
-        if (i == 3) {
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = char_array_3[2] & 0x3f;
-
-            for (i = 0; (i < 4); i++)
-                ret += base64_chars[char_array_4[i]];
-            i = 0;
-        }
+    Base64DecodeTable() {
+        for (int c = 0; c < 256; c++)
+            values[c] = BASE64_INVALID;
+        for (int i = 0; i < 64; i++)
+            values[static_cast<unsigned char>(base64_chars[i])] = static_cast<uint8_t>(i);
     }
+};
+
+static const Base64DecodeTable base64_table;
+
+#ifdef BASE64_SSSE3
+
+static bool cpu_has_ssse3() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
 
-    if (i)
-    {
-        for (j = i; j < 3; j++)
-            char_array_3[j] = '\0';
+static bool use_ssse3 = cpu_has_ssse3();
+
+// Encodes 12 bytes as 16 characters. The bit shuffle and the character
+// lookup follow Wojciech Mula's base64 SSE encoder.
+BASE64_SSSE3_TARGET
+static void base64_encode_block_ssse3(const uint8_t* in, char* out) {
+    int32_t tail;
+    memcpy(&tail, in + 8, sizeof(tail));
+    __m128i bytes = _mm_unpacklo_epi64(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in)),
+        _mm_cvtsi32_si128(tail));
+
+    // spread each 3 bytes over 4 lanes of 6 bits
+    bytes = _mm_shuffle_epi8(bytes, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(bytes, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(bytes, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    const __m128i indices = _mm_or_si128(t1, t3);
+
+    // each index range of the alphabet is a fixed offset from its character
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    range = _mm_or_si128(range, _mm_and_si128(less, _mm_set1_epi8(13)));
+    const __m128i offsets = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+        '/' - 63, 'A', 0, 0);
+    const __m128i chars = _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), chars);
+}
+
+// Decodes 16 characters into 12 bytes. Returns false, writing nothing,
+// if any of them is outside the alphabet, '=' included. Validation and
+// translation follow Wojciech Mula's base64 SSE decoder.
+BASE64_SSSE3_TARGET
+static bool base64_decode_block_ssse3(const char* in, uint8_t* out) {
+    const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    const __m128i mask_2f = _mm_set1_epi8(0x2f);
+    const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(chars, 4), mask_2f);
+    const __m128i lo_nibbles = _mm_and_si128(chars, mask_2f);
+
+    const __m128i lut_lo = _mm_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m128i lut_hi = _mm_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+    const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m128i invalid = _mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128());
+    if (_mm_movemask_epi8(invalid) != 0xFFFF)
+        return false;
+
+    const __m128i lut_roll = _mm_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i eq_2f = _mm_cmpeq_epi8(chars, mask_2f);
+    const __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+    const __m128i values = _mm_add_epi8(chars, roll);
+
+    // join 4 lanes of 6 bits into 3 bytes
+    const __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    __m128i bytes = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    bytes = _mm_shuffle_epi8(bytes, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), bytes);
+    int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(bytes, 8));
+    memcpy(out + 8, &tail, sizeof(tail));
+    return true;
+}
+
+#endif
+
+size_t base64_encoded_length(size_t count) {
+    return (count + 2) / 3 * 4;
+}
 
-        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-        char_array_4[3] = char_array_3[2] & 0x3f;
+size_t base64_encode(const uint8_t* data, size_t count, char* out) {
+    size_t i = 0;
+    char* start = out;
 
-        for (j = 0; (j < i + 1); j++)
-            ret += base64_chars[char_array_4[j]];
+#ifdef BASE64_SSSE3
+    if (use_ssse3) {
+        for (; i + 12 <= count; i += 12, out += 16)
+            base64_encode_block_ssse3(data + i, out);
+    }
+#endif
 
-        while ((i++ < 3))
-            ret += '=';
+    for (; i + 3 <= count; i += 3) {
+        uint32_t triple = (static_cast<uint32_t>(data[i]) << 16)
+            | (static_cast<uint32_t>(data[i + 1]) << 8)
+            | static_cast<uint32_t>(data[i + 2]);
+        *out++ = base64_chars[(triple >> 18) & 0x3f];
+        *out++ = base64_chars[(triple >> 12) & 0x3f];
+        *out++ = base64_chars[(triple >> 6) & 0x3f];
+        *out++ = base64_chars[triple & 0x3f];
+    }
 
+    if (i < count) {
+        uint32_t triple = static_cast<uint32_t>(data[i]) << 16;
+        if (i + 1 < count)
+            triple |= static_cast<uint32_t>(data[i + 1]) << 8;
+        *out++ = base64_chars[(triple >> 18) & 0x3f];
+        *out++ = base64_chars[(triple >> 12) & 0x3f];
+        *out++ = i + 1 < count ? base64_chars[(triple >> 6) & 0x3f] : '=';
+        *out++ = '=';
     }
 
+    return out - start;
+}
+
+// Note: only the lowest 8 bits of each integer is used.
+size_t base64_encode(const int32_t* data, size_t count, char* out) {
+    std::vector<uint8_t> bytes(data, data + count);
+    return base64_encode(bytes.data(), bytes.size(), out);
+}
+
+std::string base64_encode(std::vector<int32_t> const& data) {
+    std::string ret(base64_encoded_length(data.size()), '\0');
+    if (!data.empty())
+        base64_encode(data.data(), data.size(), &ret[0]);
     return ret;
+}
 
+// Decoding stops at the first '=' or character outside the alphabet; a
+// trailing group of n < 4 characters yields n - 1 bytes.
+size_t base64_decoded_length(size_t length) {
+    return length / 4 * 3 + 2;
 }
 
-std::string base64_decode(std::string const& encoded_string) {
-    size_t in_len = encoded_string.size();
+size_t base64_decode(const char* data, size_t length, uint8_t* out) {
+    uint8_t* bytes = out;
+    size_t in_ = 0;
+
+#ifdef BASE64_SSSE3
+    if (use_ssse3) {
+        while (in_ + 16 <= length && base64_decode_block_ssse3(data + in_, bytes)) {
+            in_ += 16;
+            bytes += 12;
+        }
+    }
+#endif
+
+    uint32_t quad = 0;
     size_t i = 0;
-    size_t j = 0;
-    int in_ = 0;
-    unsigned char char_array_4[4], char_array_3[3];
-    std::string ret;
-
-    while (in_len-- && (encoded_string[in_] != '=') && is_base64(encoded_string[in_])) {
-        char_array_4[i++] = encoded_string[in_]; in_++;
-        if (i == 4) {
-            for (i = 0; i < 4; i++)
-                char_array_4[i] = static_cast<unsigned char>(base64_chars.find(char_array_4[i]));
-
-            char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-            char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-            char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-            for (i = 0; (i < 3); i++)
-                ret += char_array_3[i];
+    for (; in_ < length; in_++) {
+        uint8_t value = base64_table.values[static_cast<unsigned char>(data[in_])];
+        if (value == BASE64_INVALID)
+            break;
+        quad = (quad << 6) | value;
+        if (++i == 4) {
+            *bytes++ = (quad >> 16) & 0xff;
+            *bytes++ = (quad >> 8) & 0xff;
+            *bytes++ = quad & 0xff;
+            quad = 0;
             i = 0;
         }
     }
 
-    if (i) {
-        for (j = i; j < 4; j++)
-            char_array_4[j] = 0;
+    if (i > 1) {
+        quad <<= 6 * (4 - i);
+        *bytes++ = (quad >> 16) & 0xff;
+        if (i > 2)
+            *bytes++ = (quad >> 8) & 0xff;
+    }
+
+    return bytes - out;
+}
 
-        for (j = 0; j < 4; j++)
-            char_array_4[j] = static_cast<unsigned char>(base64_chars.find(char_array_4[j]));
+void base64_decode(const char* data, size_t length, std::vector<uint8_t>& out) {
+    out.resize(base64_decoded_length(length));
+    out.resize(base64_decode(data, length, out.data()));
+}
 
-        char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-        char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-        char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+void base64_decode(const char* data, size_t length, std::vector<int32_t>& out) {
+    std::vector<uint8_t> bytes;
+    base64_decode(data, length, bytes);
+    out.assign(bytes.begin(), bytes.end());
+}
 
-        for (j = 0; (j < i - 1); j++) ret += char_array_3[j];
-    }
+std::string base64_decode(std::string const& encoded_string) {
+    std::vector<uint8_t> bytes;
+    base64_decode(encoded_string.data(), encoded_string.size(), bytes);
+    return std::string(bytes.begin(), bytes.end());
+}
 
-    return ret;
+bool base64_use_ssse3(bool enabled) {
+#ifdef BASE64_SSSE3
+    use_ssse3 = enabled && cpu_has_ssse3();
+    return use_ssse3;
+#else
+    (void)enabled;
+    return false;
+#endif
 }
@@ -13,5 +13,23 @@
 #include <string>
 #include <vector>
 std::string base64_encode(std::vector<int32_t> const& data);
+// Characters base64_encode writes for count bytes.
+size_t base64_encoded_length(size_t count);
+// Encodes count bytes, or the low bytes of count integers, at data into
+// out, which must have room for base64_encoded_length(count) characters;
+// returns that length.
+size_t base64_encode(const int32_t* data, size_t count, char* out);
+size_t base64_encode(const uint8_t* data, size_t count, char* out);
 std::string base64_decode(std::string const& s);
+// Bytes base64_decode may write for length characters.
+size_t base64_decoded_length(size_t length);
+// Decodes length characters at data into out, which must have room for
+// base64_decoded_length(length) bytes; returns the number written.
+size_t base64_decode(const char* data, size_t length, uint8_t* out);
+// As above, into out as bytes or one byte per integer, reusing its storage.
+void base64_decode(const char* data, size_t length, std::vector<int32_t>& out);
+void base64_decode(const char* data, size_t length, std::vector<uint8_t>& out);
+// Switches the SSSE3 paths on (where the processor has them) or off, so the
+// table path can be checked on its own; returns whether they are now used.
+bool base64_use_ssse3(bool enabled);
 #endif
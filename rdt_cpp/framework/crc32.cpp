@@ -13,6 +13,30 @@
 
 #include "crc32.h"
 
+#include <cstring>
+
+// x86 builds get a PCLMULQDQ folding kernel, chosen at run time so the
+// binary still runs on processors without it.
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define CRC32_PCLMUL
+#define CRC32_PCLMUL_TARGET
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC32_PCLMUL
+#define CRC32_PCLMUL_TARGET __attribute__((target("pclmul,sse4.1")))
+#endif
+
+#ifdef CRC32_PCLMUL
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+// The slicing algorithms read 32 bit words as little endian.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define CRC32_BIG_ENDIAN
+#endif
+
  /// compute CRC32 (standard algorithm)
 uint32_t crc32_1byte(const void* data, size_t length, uint32_t previousCrc32 = 0)
 {
@@ -25,6 +49,263 @@ uint32_t crc32_1byte(const void* data, size_t length, uint32_t previousCrc32 = 0
     return ~crc; // same as crc ^ 0xFFFFFFFF
 }
 
+/// read 32 bits from an address of any alignment
+static inline uint32_t loadWord(const uint8_t* current)
+{
+    uint32_t word;
+    memcpy(&word, current, sizeof(word));
+    return word;
+}
+
+/// compute CRC32 (Slicing-by-8 algorithm)
+uint32_t crc32_8bytes(const void* data, size_t length, uint32_t previousCrc32)
+{
+    uint32_t crc = ~previousCrc32;
+    const uint8_t* current = (const uint8_t*)data;
+
+#ifndef CRC32_BIG_ENDIAN
+    // process eight bytes at once (Slicing-by-8)
+    while (length >= 8)
+    {
+        uint32_t one = loadWord(current) ^ crc;
+        uint32_t two = loadWord(current + 4);
+        crc = Crc32Lookup[0][(two >> 24) & 0xFF] ^
+              Crc32Lookup[1][(two >> 16) & 0xFF] ^
+              Crc32Lookup[2][(two >> 8) & 0xFF] ^
+              Crc32Lookup[3][two & 0xFF] ^
+              Crc32Lookup[4][(one >> 24) & 0xFF] ^
+              Crc32Lookup[5][(one >> 16) & 0xFF] ^
+              Crc32Lookup[6][(one >> 8) & 0xFF] ^
+              Crc32Lookup[7][one & 0xFF];
+        current += 8;
+        length -= 8;
+    }
+#endif
+
+    // remaining 1 to 7 bytes (standard algorithm)
+    while (length-- != 0)
+        crc = (crc >> 8) ^ Crc32Lookup[0][(crc & 0xFF) ^ *current++];
+
+    return ~crc;
+}
+
+/// compute CRC32 (Slicing-by-16 algorithm)
+uint32_t crc32_16bytes(const void* data, size_t length, uint32_t previousCrc32)
+{
+    uint32_t crc = ~previousCrc32;
+    const uint8_t* current = (const uint8_t*)data;
+
+#ifndef CRC32_BIG_ENDIAN
+    // process sixteen bytes at once (Slicing-by-16)
+    while (length >= 16)
+    {
+        uint32_t one = loadWord(current) ^ crc;
+        uint32_t two = loadWord(current + 4);
+        uint32_t three = loadWord(current + 8);
+        uint32_t four = loadWord(current + 12);
+        crc = Crc32Lookup[0][(four >> 24) & 0xFF] ^
+              Crc32Lookup[1][(four >> 16) & 0xFF] ^
+              Crc32Lookup[2][(four >> 8) & 0xFF] ^
+              Crc32Lookup[3][four & 0xFF] ^
+              Crc32Lookup[4][(three >> 24) & 0xFF] ^
+              Crc32Lookup[5][(three >> 16) & 0xFF] ^
+              Crc32Lookup[6][(three >> 8) & 0xFF] ^
+              Crc32Lookup[7][three & 0xFF] ^
+              Crc32Lookup[8][(two >> 24) & 0xFF] ^
+              Crc32Lookup[9][(two >> 16) & 0xFF] ^
+              Crc32Lookup[10][(two >> 8) & 0xFF] ^
+              Crc32Lookup[11][two & 0xFF] ^
+              Crc32Lookup[12][(one >> 24) & 0xFF] ^
+              Crc32Lookup[13][(one >> 16) & 0xFF] ^
+              Crc32Lookup[14][(one >> 8) & 0xFF] ^
+              Crc32Lookup[15][one & 0xFF];
+        current += 16;
+        length -= 16;
+    }
+#endif
+
+    // remaining 1 to 15 bytes (standard algorithm)
+    while (length-- != 0)
+        crc = (crc >> 8) ^ Crc32Lookup[0][(crc & 0xFF) ^ *current++];
+
+    return ~crc;
+}
+
+#ifdef CRC32_PCLMUL
+
+static bool cpu_has_pclmul()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 1)) != 0 && (info[2] & (1 << 19)) != 0;
+#else
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+static const bool use_pclmul = cpu_has_pclmul();
+
+/// fold a multiple of 16 bytes, at least 64, into the (not inverted) CRC crc.
+/// Four 128 bit lanes are folded over 64 bytes at a time, then into one lane,
+/// and that is Barrett-reduced to 32 bits; constants as in Intel's "Fast CRC
+/// Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+CRC32_PCLMUL_TARGET
+static uint32_t crc32_fold_pclmul(const uint8_t* current, size_t length, uint32_t crc)
+{
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const __m128i low32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i x1 = _mm_loadu_si128((const __m128i*)(current + 0x00));
+    __m128i x2 = _mm_loadu_si128((const __m128i*)(current + 0x10));
+    __m128i x3 = _mm_loadu_si128((const __m128i*)(current + 0x20));
+    __m128i x4 = _mm_loadu_si128((const __m128i*)(current + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    current += 64;
+    length -= 64;
+
+    // fold 512 bits at once
+    while (length >= 64)
+    {
+        __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(current + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(current + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(current + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(current + 0x30)));
+        current += 64;
+        length -= 64;
+    }
+
+    // fold the four lanes into one
+    __m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // fold 128 bits at once
+    while (length >= 16)
+    {
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)current)), x5);
+        current += 16;
+        length -= 16;
+    }
+
+    // 128 bits to 64 bits
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, low32);
+    x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits
+    x2 = _mm_and_si128(x1, low32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, low32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+#endif
+
+/// compute CRC32 with the fastest kernel this processor supports
+uint32_t crc32_fast(const void* data, size_t length, uint32_t previousCrc32)
+{
+#ifdef CRC32_PCLMUL
+    if (use_pclmul && length >= 64)
+    {
+        const uint8_t* current = (const uint8_t*)data;
+        size_t folded = length & ~(size_t)15;
+        uint32_t crc = ~crc32_fold_pclmul(current, folded, ~previousCrc32);
+        return crc32_16bytes(current + folded, length - folded, crc);
+    }
+#endif
+    return crc32_16bytes(data, length, previousCrc32);
+}
+
+bool crc32_fast_uses_pclmul()
+{
+#ifdef CRC32_PCLMUL
+    return use_pclmul;
+#else
+    return false;
+#endif
+}
+
+/// crc32_combine helper: multiply the 32x32 GF(2) matrix by vector
+static uint32_t gf2_matrix_times(const uint32_t* matrix, uint32_t vector)
+{
+    uint32_t sum = 0;
+    for (; vector != 0; vector >>= 1, matrix++)
+    {
+        if (vector & 1)
+            sum ^= *matrix;
+    }
+    return sum;
+}
+
+/// crc32_combine helper: square = matrix * matrix
+static void gf2_matrix_square(uint32_t* square, const uint32_t* matrix)
+{
+    for (int i = 0; i < 32; i++)
+        square[i] = gf2_matrix_times(matrix, matrix[i]);
+}
+
+/// merge two CRC32, as zlib's crc32_combine: advance crcA over lengthB zero
+/// bytes by repeatedly squaring the one-zero-bit operator, then add crcB
+uint32_t crc32_combine(uint32_t crcA, uint32_t crcB, size_t lengthB)
+{
+    if (lengthB == 0)
+        return crcA;
+
+    uint32_t odd[32];  // operator for an odd power of two zero bits
+    uint32_t even[32]; // operator for an even power of two zero bits
+
+    odd[0] = 0xEDB88320; // reflected Polynomial
+    for (int i = 1; i < 32; i++)
+        odd[i] = 1U << (i - 1);
+
+    gf2_matrix_square(even, odd); // 2 zero bits
+    gf2_matrix_square(odd, even); // 4 zero bits
+
+    // the first squaring below makes one zero byte
+    do
+    {
+        gf2_matrix_square(even, odd);
+        if (lengthB & 1)
+            crcA = gf2_matrix_times(even, crcA);
+        lengthB >>= 1;
+        if (lengthB == 0)
+            break;
+
+        gf2_matrix_square(odd, even);
+        if (lengthB & 1)
+            crcA = gf2_matrix_times(odd, crcA);
+        lengthB >>= 1;
+    } while (lengthB != 0);
+
+    return crcA ^ crcB;
+}
+
 // //////////////////////////////////////////////////////////
 // constants
 
@@ -26,4 +26,18 @@ extern const uint32_t Crc32Lookup[MaxSlice][256]; // extern is needed to keep co
 
 /// compute CRC32 (standard algorithm)
 uint32_t crc32_1byte(const void*, size_t, uint32_t);
+/// compute CRC32 (Slicing-by-8 algorithm)
+uint32_t crc32_8bytes(const void*, size_t, uint32_t);
+/// compute CRC32 (Slicing-by-16 algorithm)
+uint32_t crc32_16bytes(const void*, size_t, uint32_t);
+/// compute CRC32 with the fastest kernel this processor supports: folding by
+/// carry-less multiplication (PCLMULQDQ) where available, else Slicing-by-16
+uint32_t crc32_fast(const void*, size_t, uint32_t);
+/// whether crc32_fast folds with PCLMULQDQ (for inputs of 64 bytes or more)
+bool crc32_fast_uses_pclmul();
+
+/// merge two CRC32 such that result = crc32(dataB, lengthB, crc32(dataA, lengthA))
+/// given crcA = crc32(dataA, lengthA) and crcB = crc32(dataB, lengthB), so that
+/// chunks can be checksummed independently, e.g. on several threads
+uint32_t crc32_combine(uint32_t crcA, uint32_t crcB, size_t lengthB);
 #endif
@@ -0,0 +1,155 @@
+/**
+ * AdaptiveWindow.cpp
+ *
+ * Window policy that sizes cwnd from a startup packet-train probe, paces
+ * the window over a round trip, and only backs off on losses the
+ * LossClassifier blames on congestion.
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#include "AdaptiveWindow.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace my_protocol {
+
+AdaptiveWindow::AdaptiveWindow()
+    : cwnd(PROBE_TRAIN), cwndGrowth(0), recoveryEnd(0), probing(false),
+      probeLen(0), probeAcked(0), probeAckedAtFirst(0), probeAckedLastBurst(0),
+      probeStartUs(0), probeFirstAckUs(0), probeLastAckUs(0), probeEndUs(0),
+      pacingIntervalUs(0), nextSendUs(0) {}
+
+// Sends the first min(PROBE_TRAIN, totalPkts) segments back to back. A file
+// no longer than the largest window the probe could seed goes out whole in
+// the train and finishes in a single round trip.
+void AdaptiveWindow::start(uint32_t totalPkts, int64_t nowUs) {
+  probing = true;
+  probeLen = std::min((uint32_t)PROBE_TRAIN, totalPkts);
+  probeAcked = 0;
+  probeAckedAtFirst = 0;
+  probeAckedLastBurst = 0;
+  probeStartUs = nowUs;
+  probeFirstAckUs = 0;
+  probeLastAckUs = 0;
+  probeEndUs = 0;
+  cwnd = probeLen;
+  cwndGrowth = 0;
+  recoveryEnd = 0;
+  pacingIntervalUs = 0;
+}
+
+void AdaptiveWindow::onRttSample(int64_t rttUs) {
+  lossClassifier.onRttSample(rttUs);
+}
+
+void AdaptiveWindow::onDelivered(uint32_t seq) {
+  if (probing) {
+    if (seq < probeLen)
+      probeAcked++;
+    return;
+  }
+  if (cwnd < MAX_CWND) {
+    cwndGrowth += 1.0 / cwnd;
+    if (cwndGrowth >= 1.0) {
+      cwndGrowth -= 1.0;
+      cwnd++;
+    }
+  }
+}
+
+// Called once per drained ACK burst. Train ACKs arrive spaced by the
+// bottleneck, so the probe remembers the first and last burst that
+// delivered train segments; they all land within about one RTT of the
+// first, and whatever is missing by then was lost.
+void AdaptiveWindow::onAckBurst(uint32_t delivered, int64_t nowUs,
+                                int64_t srttUs, int64_t rtoUs) {
+  if (delivered > 0)
+    lossClassifier.onDelivered(delivered, nowUs);
+
+  if (probing) {
+    if (probeAcked > probeAckedLastBurst) {
+      if (probeFirstAckUs == 0) {
+        probeFirstAckUs = nowUs;
+        probeAckedAtFirst = probeAcked;
+      }
+      probeLastAckUs = nowUs;
+      probeAckedLastBurst = probeAcked;
+    }
+    if (probeAcked >= probeLen || nowUs - probeStartUs > rtoUs ||
+        (probeFirstAckUs > 0 && nowUs - probeFirstAckUs > srttUs))
+      finishProbe(nowUs);
+    return;
+  }
+
+  // Pace the window evenly over a round trip, slightly faster so the ACK
+  // clock rather than the pacer limits the rate. The first window after the
+  // probe keeps the pace of the measured rate.
+  if (srttUs > 0 && nowUs - probeEndUs >= srttUs)
+    pacingIntervalUs = (int64_t)(srttUs / (cwnd * PACING_GAIN));
+}
+
+// Turns the train's ACK dispersion into a bottleneck rate, which sets the
+// initial pace, and rate x min RTT into the initial window. Without two
+// spaced ACKs there is no rate estimate, and the train size is kept.
+void AdaptiveWindow::finishProbe(int64_t nowUs) {
+  probing = false;
+  probeEndUs = nowUs;
+  int64_t minRttUs = lossClassifier.getMinRttUs();
+  int64_t spanUs = probeLastAckUs - probeFirstAckUs;
+  uint32_t delivered = probeAcked - probeAckedAtFirst;
+  if (delivered == 0 || spanUs <= 0 || minRttUs == 0) {
+    std::cout << "Probe: no dispersion, keeping cwnd " << cwnd << std::endl;
+    return;
+  }
+
+  // Jitter can squeeze the dispersion and overstate the rate, so the seed is
+  // capped at one train.
+  double ratePps = delivered * 1e6 / spanUs;
+  double bdp = ratePps * minRttUs / 1e6;
+  cwnd = std::min(std::max((uint32_t)(bdp + 0.5), (uint32_t)MIN_CWND),
+                  (uint32_t)PROBE_TRAIN);
+  pacingIntervalUs = (int64_t)(1e6 / (ratePps * PACING_GAIN));
+  nextSendUs = nowUs;
+  std::cout << "Probe: " << (int)ratePps << " pkt/s, min rtt "
+            << minRttUs / 1000.0 << " ms, cwnd " << cwnd << std::endl;
+}
+
+// Only a loss the classifier blames on our own queue shrinks the window;
+// random channel drops are just repaired. A burst of losses is one
+// recovery episode: after a cut, losses of segments below the send edge
+// at that cut were already answered by it, so only a segment first sent
+// after the cut can cut again.
+void AdaptiveWindow::onLoss(uint32_t seq, uint32_t sendEnd) {
+  if (lossClassifier.classify() != LossClassifier::CONGESTION_LOSS)
+    return;
+  if (seq < recoveryEnd)
+    return;
+  recoveryEnd = sendEnd;
+  cwnd = std::max((uint32_t)(cwnd * CWND_BETA), (uint32_t)MIN_CWND);
+  cwndGrowth = 0;
+}
+
+// Token bucket over the pacing interval; lets at most MAX_PACING_BURST
+// packets out together after the loop has been idle.
+bool AdaptiveWindow::paceAllows(int64_t nowUs) {
+  if (pacingIntervalUs == 0)
+    return true;
+  int64_t floor = nowUs - MAX_PACING_BURST * pacingIntervalUs;
+  if (nextSendUs < floor)
+    nextSendUs = floor;
+  if (nextSendUs > nowUs)
+    return false;
+  nextSendUs += pacingIntervalUs;
+  return true;
+}
+
+uint32_t AdaptiveWindow::getCwnd() const { return cwnd; }
+
+const LossClassifier::Stats &AdaptiveWindow::getLossStats() const {
+  return lossClassifier.getStats();
+}
+
+} /* namespace my_protocol */
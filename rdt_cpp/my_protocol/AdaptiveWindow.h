@@ -0,0 +1,67 @@
+/**
+ * AdaptiveWindow.h
+ *
+ * Window policy that sizes cwnd from a startup packet-train probe, paces
+ * the window over a round trip, and only backs off on losses the
+ * LossClassifier blames on congestion.
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#ifndef AdaptiveWindow_H_
+#define AdaptiveWindow_H_
+
+#include "LossClassifier.h"
+#include <cstdint>
+
+namespace my_protocol {
+
+class AdaptiveWindow {
+
+public:
+  AdaptiveWindow();
+
+  void start(uint32_t totalPkts, int64_t nowUs);
+  void onRttSample(int64_t rttUs);
+  void onDelivered(uint32_t seq);
+  void onAckBurst(uint32_t delivered, int64_t nowUs, int64_t srttUs,
+                  int64_t rtoUs);
+  void onLoss(uint32_t seq, uint32_t sendEnd);
+  bool paceAllows(int64_t nowUs);
+
+  uint32_t getCwnd() const;
+  const LossClassifier::Stats &getLossStats() const;
+
+private:
+  static const uint32_t PROBE_TRAIN = 64; // back-to-back startup segments
+  static const uint32_t MIN_CWND = 4;
+  static const uint32_t MAX_CWND = 512;
+  static const int64_t MAX_PACING_BURST = 4;
+  static constexpr double CWND_BETA = 0.7; // cut on congestion loss
+  static constexpr double PACING_GAIN = 1.25;
+
+  LossClassifier lossClassifier;
+  uint32_t cwnd;
+  double cwndGrowth; // fractional additive increase
+  uint32_t recoveryEnd; // sendEnd at the last cut; losses below it are old
+
+  // Startup packet-train probe, then pacing at the measured bottleneck.
+  bool probing;
+  uint32_t probeLen;
+  uint32_t probeAcked;
+  uint32_t probeAckedAtFirst;
+  uint32_t probeAckedLastBurst;
+  int64_t probeStartUs;
+  int64_t probeFirstAckUs;
+  int64_t probeLastAckUs;
+  int64_t probeEndUs;       // paced at the probed rate for an RTT after
+  int64_t pacingIntervalUs; // 0 = unpaced
+  int64_t nextSendUs;
+
+  void finishProbe(int64_t nowUs);
+};
+
+} /* namespace my_protocol */
+
+#endif /* AdaptiveWindow_H_ */
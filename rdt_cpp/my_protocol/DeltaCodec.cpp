@@ -0,0 +1,271 @@
+/**
+ * DeltaCodec.cpp
+ *
+ * Delta stream: magic 'D', target size(4), target CRC32(4), then ops:
+ *   OP_COPY    block(2) count(2)   count basis blocks starting at block
+ *   OP_LITERAL len(2) bytes...     len bytes taken as they are
+ * All integers big-endian, like the packet headers.
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#include "DeltaCodec.h"
+#include "../framework/crc32.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <unordered_map>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace my_protocol {
+
+namespace {
+
+void putBytes(std::vector<int32_t> &out, uint32_t v, int n) {
+  for (int i = n - 1; i >= 0; i--)
+    out.push_back((v >> (8 * i)) & 0xFF);
+}
+
+uint32_t getBytes(const std::vector<int32_t> &in, size_t at, int n) {
+  uint32_t v = 0;
+  for (int i = 0; i < n; i++)
+    v = (v << 8) | (in[at + i] & 0xFF);
+  return v;
+}
+
+} // namespace
+
+// rsync's rolling checksum: a is the byte sum, b the position-weighted
+// sum, both mod 2^16, so sliding the window by one byte is O(1).
+uint32_t DeltaCodec::weakChecksum(const std::vector<int32_t> &data,
+                                  size_t at, uint32_t len) {
+  uint32_t a = 0, b = 0;
+  for (uint32_t i = 0; i < len; i++) {
+    a += data[at + i] & 0xFF;
+    b += (len - i) * (data[at + i] & 0xFF);
+  }
+  return (a & 0xFFFF) | (b << 16);
+}
+
+// 64-bit FNV-1a, checked only after a weak match.
+uint64_t DeltaCodec::strongHash(const std::vector<int32_t> &data, size_t at,
+                                uint32_t len) {
+  uint64_t h = 0xCBF29CE484222325ULL;
+  for (uint32_t i = 0; i < len; i++) {
+    h ^= (uint8_t)(data[at + i] & 0xFF);
+    h *= 0x100000001B3ULL;
+  }
+  return h;
+}
+
+uint32_t DeltaCodec::crcOf(const std::vector<int32_t> &data) {
+  std::vector<uint8_t> bytes(data.begin(), data.end());
+  return crc32_fast(bytes.data(), bytes.size(), 0);
+}
+
+std::vector<BlockSignature>
+DeltaCodec::signatures(const std::vector<int32_t> &basis) {
+  std::vector<BlockSignature> sigs(basis.size() / BLOCK_SIZE);
+  for (size_t i = 0; i < sigs.size(); i++) {
+    sigs[i].valid = true;
+    sigs[i].weak = weakChecksum(basis, i * BLOCK_SIZE, BLOCK_SIZE);
+    sigs[i].strong = strongHash(basis, i * BLOCK_SIZE, BLOCK_SIZE);
+  }
+  return sigs;
+}
+
+std::vector<int32_t>
+DeltaCodec::encode(const std::vector<int32_t> &target,
+                   const std::vector<BlockSignature> &sigs,
+                   uint32_t *matchedBlocks) {
+  std::unordered_map<uint32_t, std::vector<uint32_t>> byWeak;
+  for (uint32_t i = 0; i < sigs.size(); i++) {
+    if (sigs[i].valid)
+      byWeak[sigs[i].weak].push_back(i);
+  }
+
+  std::vector<int32_t> out;
+  out.push_back((int32_t)MAGIC);
+  putBytes(out, (uint32_t)target.size(), 4);
+  putBytes(out, crcOf(target), 4);
+
+  uint32_t copyStart = 0, copyCount = 0;
+  size_t literalStart = 0;
+  *matchedBlocks = 0;
+
+  auto flushCopy = [&]() {
+    if (copyCount == 0)
+      return;
+    out.push_back(OP_COPY);
+    putBytes(out, copyStart, 2);
+    putBytes(out, copyCount, 2);
+    copyCount = 0;
+  };
+  auto flushLiteral = [&](size_t end) {
+    if (literalStart < end)
+      flushCopy();
+    while (literalStart < end) {
+      size_t maxLen = MAX_LITERAL;
+      uint32_t len = (uint32_t)std::min(end - literalStart, maxLen);
+      out.push_back(OP_LITERAL);
+      putBytes(out, len, 2);
+      for (uint32_t i = 0; i < len; i++)
+        out.push_back(target[literalStart + i] & 0xFF);
+      literalStart += len;
+    }
+  };
+
+  size_t n = target.size();
+  size_t pos = 0;
+  uint32_t a = 0, b = 0;
+  bool haveSums = false;
+  while (!byWeak.empty() && pos + BLOCK_SIZE <= n) {
+    if (!haveSums) {
+      uint32_t w = weakChecksum(target, pos, BLOCK_SIZE);
+      a = w & 0xFFFF;
+      b = w >> 16;
+      haveSums = true;
+    }
+
+    int64_t found = -1;
+    std::unordered_map<uint32_t, std::vector<uint32_t>>::const_iterator it =
+        byWeak.find((a & 0xFFFF) | (b << 16));
+    if (it != byWeak.end()) {
+      uint64_t strong = strongHash(target, pos, BLOCK_SIZE);
+      for (uint32_t block : it->second) {
+        if (sigs[block].strong == strong) {
+          found = block;
+          break;
+        }
+      }
+    }
+
+    if (found >= 0) {
+      flushLiteral(pos);
+      if (copyCount > 0 && copyStart + copyCount == (uint32_t)found &&
+          copyCount < MAX_COPY) {
+        copyCount++;
+      } else {
+        flushCopy();
+        copyStart = (uint32_t)found;
+        copyCount = 1;
+      }
+      (*matchedBlocks)++;
+      pos += BLOCK_SIZE;
+      literalStart = pos;
+      haveSums = false;
+      continue;
+    }
+
+    // Slide the window one byte.
+    if (pos + BLOCK_SIZE < n) {
+      uint32_t out0 = target[pos] & 0xFF;
+      uint32_t in = target[pos + BLOCK_SIZE] & 0xFF;
+      a = (a - out0 + in) & 0xFFFF;
+      b = (b - BLOCK_SIZE * out0 + a) & 0xFFFF;
+    }
+    pos++;
+  }
+  flushLiteral(n);
+  flushCopy();
+  return out;
+}
+
+bool DeltaCodec::decode(const std::vector<int32_t> &delta,
+                        const std::vector<int32_t> &basis,
+                        std::vector<int32_t> &out) {
+  if (delta.size() < HEADER || (delta[0] & 0xFF) != MAGIC)
+    return false;
+  uint32_t size = getBytes(delta, 1, 4);
+  uint32_t crc = getBytes(delta, 5, 4);
+  out.clear();
+  out.reserve(size);
+
+  size_t at = HEADER;
+  while (at < delta.size()) {
+    uint32_t op = delta[at] & 0xFF;
+    if (op == OP_COPY) {
+      if (at + 5 > delta.size())
+        return false;
+      size_t first = (size_t)getBytes(delta, at + 1, 2) * BLOCK_SIZE;
+      size_t len = (size_t)getBytes(delta, at + 3, 2) * BLOCK_SIZE;
+      if (first + len > basis.size())
+        return false;
+      for (size_t i = 0; i < len; i++)
+        out.push_back(basis[first + i] & 0xFF);
+      at += 5;
+    } else if (op == OP_LITERAL) {
+      if (at + 3 > delta.size())
+        return false;
+      uint32_t len = getBytes(delta, at + 1, 2);
+      if (at + 3 + len > delta.size())
+        return false;
+      out.insert(out.end(), delta.begin() + at + 3,
+                 delta.begin() + at + 3 + len);
+      at += 3 + len;
+    } else {
+      return false;
+    }
+  }
+  return out.size() == size && crcOf(out) == crc;
+}
+
+std::string DeltaCodec::findLatestOutput(const std::string &id) {
+  std::string prefix = "rdtcOutput" + id + ".";
+  std::string suffix = ".png";
+  std::string best;
+  unsigned long long bestStamp = 0;
+
+  std::vector<std::string> names;
+#ifdef _MSC_VER
+  WIN32_FIND_DATAA found;
+  HANDLE h = FindFirstFileA((prefix + "*" + suffix).c_str(), &found);
+  if (h != INVALID_HANDLE_VALUE) {
+    do {
+      names.push_back(found.cFileName);
+    } while (FindNextFileA(h, &found));
+    FindClose(h);
+  }
+#else
+  DIR *dir = opendir(".");
+  if (dir != nullptr) {
+    while (struct dirent *entry = readdir(dir))
+      names.push_back(entry->d_name);
+    closedir(dir);
+  }
+#endif
+
+  for (const std::string &name : names) {
+    if (name.size() <= prefix.size() + suffix.size() ||
+        name.compare(0, prefix.size(), prefix) != 0 ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+      continue;
+    std::string stamp = name.substr(
+        prefix.size(), name.size() - prefix.size() - suffix.size());
+    char *end = nullptr;
+    unsigned long long value = strtoull(stamp.c_str(), &end, 10);
+    if (*end != '\0' || value < bestStamp)
+      continue;
+    bestStamp = value;
+    best = name;
+  }
+  return best;
+}
+
+std::vector<int32_t> DeltaCodec::readFile(const std::string &path) {
+  std::ifstream ifs(path, std::ifstream::binary);
+  std::vector<int32_t> contents;
+  char c;
+  while (ifs.get(c))
+    contents.push_back(c & 0xFF);
+  return contents;
+}
+
+} /* namespace my_protocol */
@@ -0,0 +1,70 @@
+/**
+ * DeltaCodec.h
+ *
+ * rsync-style delta encoding. The receiver describes fixed-size blocks of
+ * an older copy (the basis) by a rolling checksum and a strong hash; the
+ * sender then expresses the new file as copies of matching basis blocks
+ * and literal bytes for everything else.
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#ifndef DeltaCodec_H_
+#define DeltaCodec_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace my_protocol {
+
+struct BlockSignature {
+  bool valid = false; // false until the sender has received it
+  uint32_t weak = 0;
+  uint64_t strong = 0;
+};
+
+class DeltaCodec {
+
+public:
+  static const uint32_t BLOCK_SIZE = 512;
+
+  // Signatures of every full block of basis.
+  static std::vector<BlockSignature>
+  signatures(const std::vector<int32_t> &basis);
+
+  // Encodes target against the basis described by sigs. Blocks whose
+  // signature never arrived are simply not matched.
+  static std::vector<int32_t>
+  encode(const std::vector<int32_t> &target,
+         const std::vector<BlockSignature> &sigs, uint32_t *matchedBlocks);
+
+  // Rebuilds the target from delta and basis; false if delta is malformed
+  // or the result does not match the size and CRC it was encoded with.
+  static bool decode(const std::vector<int32_t> &delta,
+                     const std::vector<int32_t> &basis,
+                     std::vector<int32_t> &out);
+
+  // Newest rdtcOutput<id>.<timestamp>.png in the working directory, or ""
+  // if there is none.
+  static std::string findLatestOutput(const std::string &id);
+  static std::vector<int32_t> readFile(const std::string &path);
+
+private:
+  enum : uint8_t { OP_COPY = 1, OP_LITERAL = 2 };
+  static const uint8_t MAGIC = 'D';
+  static const uint32_t HEADER = 9;        // magic(1) + size(4) + crc(4)
+  static const uint32_t MAX_LITERAL = 0xFFFF;
+  static const uint32_t MAX_COPY = 0xFFFF; // blocks per copy op
+
+  static uint32_t weakChecksum(const std::vector<int32_t> &data, size_t at,
+                               uint32_t len);
+  static uint64_t strongHash(const std::vector<int32_t> &data, size_t at,
+                             uint32_t len);
+  static uint32_t crcOf(const std::vector<int32_t> &data);
+};
+
+} /* namespace my_protocol */
+
+#endif /* DeltaCodec_H_ */
@@ -0,0 +1,108 @@
+/**
+ * ErasureCode.cpp
+ *
+ * GF(256) with the AES polynomial x^8 + x^4 + x^3 + x + 1, multiplied via
+ * log/exp tables over the generator 3.
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#include "ErasureCode.h"
+
+#include <algorithm>
+
+namespace my_protocol {
+
+namespace {
+
+struct GfTables {
+  uint8_t exp[512];
+  uint8_t log[256];
+
+  GfTables() {
+    uint32_t x = 1;
+    for (uint32_t i = 0; i < 255; i++) {
+      exp[i] = (uint8_t)x;
+      log[x] = (uint8_t)i;
+      x ^= (x << 1) ^ ((x & 0x80) ? 0x11B : 0); // x *= 3
+      x &= 0xFF;
+    }
+    for (uint32_t i = 255; i < 512; i++)
+      exp[i] = exp[i - 255];
+    log[0] = 0;
+  }
+};
+
+const GfTables gf;
+
+} // namespace
+
+uint8_t ErasureCode::mul(uint8_t a, uint8_t b) {
+  if (a == 0 || b == 0)
+    return 0;
+  return gf.exp[gf.log[a] + gf.log[b]];
+}
+
+uint8_t ErasureCode::inv(uint8_t a) { return gf.exp[255 - gf.log[a]]; }
+
+// Rows x_j = j and columns y_i = 128 + i never meet, so x_j ^ y_i != 0.
+uint8_t ErasureCode::coefficient(uint32_t repair, uint32_t source) {
+  return inv((uint8_t)(repair ^ (MAX_REPAIRS + source)));
+}
+
+void ErasureCode::addScaled(uint8_t *dst, const uint8_t *src, uint8_t c,
+                            size_t len) {
+  if (c == 0)
+    return;
+  if (c == 1) {
+    for (size_t i = 0; i < len; i++)
+      dst[i] ^= src[i];
+    return;
+  }
+  uint32_t logC = gf.log[c];
+  for (size_t i = 0; i < len; i++) {
+    if (src[i] != 0)
+      dst[i] ^= gf.exp[logC + gf.log[src[i]]];
+  }
+}
+
+// Gauss-Jordan, taking each pivot from any row not used yet and applying
+// every row operation to the residuals as well.
+bool ErasureCode::solve(std::vector<std::vector<uint8_t>> &rows,
+                        std::vector<std::vector<uint8_t>> &residuals) {
+  size_t n = rows.empty() ? 0 : rows[0].size();
+  size_t count = std::min(rows.size(), residuals.size());
+  if (count < n)
+    return false;
+  size_t len = n > 0 ? residuals[0].size() : 0;
+
+  for (size_t col = 0; col < n; col++) {
+    size_t pivot = col;
+    while (pivot < count && rows[pivot][col] == 0)
+      pivot++;
+    if (pivot == count)
+      return false;
+    rows[pivot].swap(rows[col]);
+    residuals[pivot].swap(residuals[col]);
+
+    uint8_t scale = inv(rows[col][col]);
+    for (size_t c = 0; c < n; c++)
+      rows[col][c] = mul(rows[col][c], scale);
+    for (size_t c = 0; c < len; c++)
+      residuals[col][c] = mul(residuals[col][c], scale);
+
+    for (size_t r = 0; r < count; r++) {
+      uint8_t f = rows[r][col];
+      if (r == col || f == 0)
+        continue;
+      for (size_t c = 0; c < n; c++)
+        rows[r][c] ^= mul(f, rows[col][c]);
+      addScaled(residuals[r].data(), residuals[col].data(), f, len);
+    }
+  }
+  residuals.resize(n);
+  return true;
+}
+
+} /* namespace my_protocol */
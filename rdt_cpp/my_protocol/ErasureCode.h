@@ -0,0 +1,49 @@
+/**
+ * ErasureCode.h
+ *
+ * Systematic erasure code over GF(256). Repair symbol j of a block is
+ * sum_i C[j][i] * source_i, with C a Cauchy matrix, so any square part of
+ * C is invertible: a block of k sources is recovered from any k of its
+ * sources and repairs together.
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#ifndef ErasureCode_H_
+#define ErasureCode_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace my_protocol {
+
+class ErasureCode {
+
+public:
+  static const uint32_t MAX_SOURCES = 128; // per block
+  static const uint32_t MAX_REPAIRS = 128; // per block
+
+  static uint8_t coefficient(uint32_t repair, uint32_t source);
+
+  // dst ^= c * src over len bytes.
+  static void addScaled(uint8_t *dst, const uint8_t *src, uint8_t c,
+                        size_t len);
+
+  // Solves for n unknown sources, given one residual per repair: the
+  // repair payload with every known source's share already subtracted.
+  // rows[r][c] is the coefficient of unknown c in residual r, zero where
+  // the repair does not cover that source. Needs an invertible n x n part
+  // among the rows; on success residuals[c] holds unknown c.
+  static bool solve(std::vector<std::vector<uint8_t>> &rows,
+                    std::vector<std::vector<uint8_t>> &residuals);
+
+private:
+  static uint8_t mul(uint8_t a, uint8_t b);
+  static uint8_t inv(uint8_t a);
+};
+
+} /* namespace my_protocol */
+
+#endif /* ErasureCode_H_ */
@@ -0,0 +1,91 @@
+/**
+ * FecPlanner.cpp
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#include "FecPlanner.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace my_protocol {
+
+FecPlanner::FecPlanner()
+    : outcomes(0), losses(0), bursts(0), seen(0), currentBurst(0) {
+  std::fill(burstLengths, burstLengths + MAX_DEPTH + 1, 0.0);
+}
+
+// Exponentially decayed counts, so the plan follows a channel that changes
+// during the transfer.
+void FecPlanner::onOutcome(bool lost) {
+  outcomes = outcomes * DECAY + 1;
+  losses *= DECAY;
+  bursts *= DECAY;
+  for (double &n : burstLengths)
+    n *= DECAY;
+  seen++;
+
+  if (lost) {
+    losses += 1;
+    currentBurst++;
+  } else if (currentBurst > 0) {
+    endBurst();
+  }
+}
+
+void FecPlanner::endBurst() {
+  bursts += 1;
+  uint32_t longest = MAX_DEPTH + 1;
+  burstLengths[std::min(currentBurst, longest) - 1] += 1;
+  currentBurst = 0;
+}
+
+// Probability that more than parity of sources + parity symbols are lost,
+// with independent losses at the given rate.
+double FecPlanner::residual(uint32_t sources, uint32_t parity, double loss) {
+  uint32_t n = sources + parity;
+  double covered = 0;
+  double term = std::pow(1 - loss, (double)n); // P(0 lost)
+  for (uint32_t lost = 0; lost <= parity; lost++) {
+    covered += term;
+    term *= (double)(n - lost) / (lost + 1) * loss / (1 - loss);
+  }
+  return std::max(0.0, 1 - covered);
+}
+
+// Interleaving deep enough for BURST_COVER of the bursts leaves each block
+// about one loss per burst, so blocks then see roughly independent losses
+// at the measured rate, and parity is sized for that.
+FecPlan FecPlanner::plan() const {
+  FecPlan p;
+  p.blockSize = BLOCK_SIZE;
+  double loss = getLossRate();
+  if (seen < MIN_OUTCOMES || loss <= 0 || bursts <= 0)
+    return p;
+
+  double covered = 0;
+  while (p.depth < MAX_DEPTH) {
+    covered += burstLengths[p.depth - 1];
+    if (covered >= BURST_COVER * bursts)
+      break;
+    p.depth++;
+  }
+
+  loss = std::min(loss, 0.5);
+  while (p.parity < MAX_PARITY &&
+         residual(BLOCK_SIZE, p.parity, loss) > TARGET_RESIDUAL)
+    p.parity++;
+  return p;
+}
+
+double FecPlanner::getLossRate() const {
+  return outcomes > 0 ? losses / outcomes : 0;
+}
+
+double FecPlanner::getMeanBurst() const {
+  return bursts > 0 ? losses / bursts : 0;
+}
+
+} /* namespace my_protocol */
@@ -0,0 +1,64 @@
+/**
+ * FecPlanner.h
+ *
+ * Chooses the forward error correction for the next frame of segments from
+ * how the channel has been losing them: an interleaving depth that spreads
+ * typical bursts over separate blocks, and the fewest repairs per block
+ * that keep the chance of a block still missing segments below a target.
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#ifndef FecPlanner_H_
+#define FecPlanner_H_
+
+#include <cstdint>
+
+namespace my_protocol {
+
+// A frame is blockSize * depth consecutive segments; block j of it takes
+// every depth-th segment starting at j, and gets parity repairs.
+struct FecPlan {
+  uint32_t blockSize = 0;
+  uint32_t depth = 1;
+  uint32_t parity = 0;
+};
+
+class FecPlanner {
+
+public:
+  FecPlanner();
+
+  // Whether the first transmission of the next segment, in send order,
+  // was lost.
+  void onOutcome(bool lost);
+
+  FecPlan plan() const;
+
+  double getLossRate() const;
+  double getMeanBurst() const;
+
+private:
+  static const uint32_t BLOCK_SIZE = 16;
+  static const uint32_t MAX_DEPTH = 8;
+  static const uint32_t MAX_PARITY = 8;
+  static const uint32_t MIN_OUTCOMES = 32; // before trusting the estimate
+  static constexpr double DECAY = 0.995;   // per outcome, ~200 remembered
+  static constexpr double TARGET_RESIDUAL = 0.05; // per block, ARQ fills
+  static constexpr double BURST_COVER = 0.9; // bursts one depth spreads
+
+  double outcomes;
+  double losses;
+  double bursts;
+  double burstLengths[MAX_DEPTH + 1]; // [MAX_DEPTH] is "longer"
+  uint32_t seen;
+  uint32_t currentBurst;
+
+  void endBurst();
+  static double residual(uint32_t sources, uint32_t parity, double loss);
+};
+
+} /* namespace my_protocol */
+
+#endif /* FecPlanner_H_ */
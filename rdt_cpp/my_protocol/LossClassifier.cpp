@@ -0,0 +1,74 @@
+/**
+ * LossClassifier.cpp
+ *
+ * Tells random, non-congestive loss apart from queue-overflow loss, so the
+ * sender only backs off when its own rate is the cause.
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#include "LossClassifier.h"
+
+#include <algorithm>
+
+namespace my_protocol {
+
+LossClassifier::LossClassifier()
+    : minRttUs(0), recentRttUs(0), intervalDelivered(0), intervalStartUs(0),
+      deliveryRate(0), peakDeliveryRate(0) {}
+
+void LossClassifier::onRttSample(int64_t rttUs) {
+  if (minRttUs == 0 || rttUs < minRttUs)
+    minRttUs = rttUs;
+  if (recentRttUs == 0)
+    recentRttUs = rttUs;
+  else
+    recentRttUs += (rttUs - recentRttUs) / 4;
+}
+
+// Delivery rate is sampled over intervals of at least one min RTT, so a
+// single ACK burst does not read as a rate spike. The peak decays slowly so
+// it follows a path whose capacity drops.
+void LossClassifier::onDelivered(uint32_t count, int64_t nowUs) {
+  if (intervalStartUs == 0)
+    intervalStartUs = nowUs;
+  intervalDelivered += count;
+
+  int64_t span = nowUs - intervalStartUs;
+  int64_t minSpan = MIN_INTERVAL_US;
+  if (span < std::max(minRttUs, minSpan))
+    return;
+
+  deliveryRate = intervalDelivered * 1e6 / span;
+  peakDeliveryRate = std::max(deliveryRate, peakDeliveryRate * PEAK_DECAY);
+  intervalDelivered = 0;
+  intervalStartUs = nowUs;
+}
+
+// Queue overflow shows up as an inflated RTT at a saturated delivery rate.
+// Loss with a flat RTT, or while delivery is still below its peak, is
+// taken to be the channel's own random drop.
+LossClassifier::Verdict LossClassifier::classify() {
+  int64_t margin = (int64_t)(minRttUs * RTT_INFLATION);
+  if (margin < RTT_INFLATION_FLOOR_US)
+    margin = RTT_INFLATION_FLOOR_US;
+  bool inflated = minRttUs > 0 && recentRttUs - minRttUs > margin;
+  bool saturated =
+      peakDeliveryRate > 0 && deliveryRate >= peakDeliveryRate * DELIVERY_PLATEAU;
+
+  if (inflated && saturated) {
+    stats.congestionLosses++;
+    return CONGESTION_LOSS;
+  }
+  stats.randomLosses++;
+  return RANDOM_LOSS;
+}
+
+int64_t LossClassifier::getMinRttUs() const { return minRttUs; }
+
+double LossClassifier::getDeliveryRate() const { return deliveryRate; }
+
+const LossClassifier::Stats &LossClassifier::getStats() const { return stats; }
+
+} /* namespace my_protocol */
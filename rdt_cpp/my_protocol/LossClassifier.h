@@ -0,0 +1,60 @@
+/**
+ * LossClassifier.h
+ *
+ * Tells random, non-congestive loss apart from queue-overflow loss, so the
+ * sender only backs off when its own rate is the cause.
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#ifndef LossClassifier_H_
+#define LossClassifier_H_
+
+#include <cstdint>
+
+namespace my_protocol {
+
+class LossClassifier {
+
+public:
+  enum Verdict { RANDOM_LOSS, CONGESTION_LOSS };
+
+  struct Stats {
+    uint64_t randomLosses = 0;
+    uint64_t congestionLosses = 0;
+  };
+
+  LossClassifier();
+
+  void onRttSample(int64_t rttUs);
+  void onDelivered(uint32_t count, int64_t nowUs);
+  Verdict classify();
+
+  int64_t getMinRttUs() const;
+  double getDeliveryRate() const;
+  const Stats &getStats() const;
+
+private:
+  // A loss is congestive only if RTT sits this far above its minimum...
+  static constexpr double RTT_INFLATION = 0.25;
+  static const int64_t RTT_INFLATION_FLOOR_US = 2000;
+  // ...while delivery runs at this fraction of its recent peak.
+  static constexpr double DELIVERY_PLATEAU = 0.9;
+  static constexpr double PEAK_DECAY = 0.98;
+  static const int64_t MIN_INTERVAL_US = 10000;
+
+  int64_t minRttUs;
+  int64_t recentRttUs; // EWMA, gain 1/4, of the latest samples
+
+  uint32_t intervalDelivered;
+  int64_t intervalStartUs;
+  double deliveryRate;    // packets per second over the last interval
+  double peakDeliveryRate;
+
+  Stats stats;
+};
+
+} /* namespace my_protocol */
+
+#endif /* LossClassifier_H_ */
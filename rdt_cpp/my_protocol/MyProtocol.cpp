@@ -18,76 +18,763 @@
 //Ilia Mirzaali, s3534162
 
 #include "MyProtocol.h"
+#include "../framework/crc32.h"
 
 #include <algorithm>
 #include <chrono>
+#include <map>
 #include <thread>
 
 namespace my_protocol {
 
-int64_t MyProtocol::nowMs() {
+ProtocolMetrics::ProtocolMetrics()
+    : packetsSent(framework::MetricsRegistry::shared().counter(
+          "protocol.packets_sent")),
+      retransmits(framework::MetricsRegistry::shared().counter(
+          "protocol.retransmits")),
+      packetsReceived(framework::MetricsRegistry::shared().counter(
+          "protocol.packets_received")),
+      duplicates(framework::MetricsRegistry::shared().counter(
+          "protocol.duplicates")),
+      checksumFailed(framework::MetricsRegistry::shared().counter(
+          "protocol.checksum_failed")),
+      acksSent(
+          framework::MetricsRegistry::shared().counter("protocol.acks_sent")),
+      acksReceived(framework::MetricsRegistry::shared().counter(
+          "protocol.acks_received")),
+      sackRecovered(framework::MetricsRegistry::shared().counter(
+          "protocol.sack_recovered")),
+      rttUs(framework::MetricsRegistry::shared().histogram("protocol.rtt_us")),
+      sendTime(framework::MetricsRegistry::shared().counter(
+          "protocol.phase.send_us")),
+      receiveTime(framework::MetricsRegistry::shared().counter(
+          "protocol.phase.receive_us")) {}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+int64_t BasicProtocol<Window, Ack, Codec, Recovery, Mode>::nowMs() {
   return std::chrono::duration_cast<std::chrono::milliseconds>(
              std::chrono::steady_clock::now().time_since_epoch())
       .count();
 }
 
-std::vector<int32_t>
-MyProtocol::buildDataPacket(uint32_t seq, uint32_t total,
-                            const std::vector<int32_t> &fileData,
-                            uint32_t offset, uint32_t len) {
-  std::vector<int32_t> pkt(DATA_HEADER + len);
-  pkt[0] = TYPE_DATA;
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+int64_t BasicProtocol<Window, Ack, Codec, Recovery, Mode>::nowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+framework::Packet
+BasicProtocol<Window, Ack, Codec, Recovery, Mode>::buildDataPacket(
+    uint32_t seq, uint32_t total, const std::vector<int32_t> &fileData,
+    uint32_t offset, uint32_t len) {
+  uint32_t header = DATA_HEADER + (USE_TIMESTAMPS ? (uint32_t)TS_OPTION : 0U);
+  framework::Packet pkt(header + len);
+  pkt[0] = TYPE_DATA | (USE_TIMESTAMPS ? (uint32_t)FLAG_TS : 0U);
   pkt[1] = (seq >> 8) & 0xFF;
   pkt[2] = seq & 0xFF;
   pkt[3] = (total >> 8) & 0xFF;
   pkt[4] = total & 0xFF;
-  pkt[5] = (pkt[1] ^ pkt[2] ^ pkt[3] ^ pkt[4]) & 0xFF;
+  pkt[5] = Codec::check(pkt, DATA_HEADER, header);
   for (uint32_t i = 0; i < len; i++) {
-    pkt[DATA_HEADER + i] = fileData[offset + i] & 0xFF;
+    pkt[header + i] = fileData[offset + i] & 0xFF;
   }
   return pkt;
 }
 
-std::vector<int32_t> MyProtocol::buildAckPacket(uint32_t ackBase,
-                                                uint16_t sackMask) {
-  std::vector<int32_t> pkt(ACK_HEADER);
-  pkt[0] = TYPE_ACK;
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+framework::Packet
+BasicProtocol<Window, Ack, Codec, Recovery, Mode>::buildAckPacket(
+    uint32_t ackBase, uint16_t advertised, const std::vector<uint8_t> &sack,
+    bool echo, uint32_t tsEcr) {
+  uint32_t header = ACK_HEADER + (echo ? (uint32_t)TS_OPTION : 0U);
+  framework::Packet pkt(header + sack.size());
+  pkt[0] = TYPE_ACK | (echo ? (uint32_t)FLAG_TS : 0U);
   pkt[1] = (ackBase >> 8) & 0xFF;
   pkt[2] = ackBase & 0xFF;
-  pkt[3] = (sackMask >> 8) & 0xFF;
-  pkt[4] = sackMask & 0xFF;
-  pkt[5] = (pkt[1] ^ pkt[2] ^ pkt[3] ^ pkt[4]) & 0xFF;
+  pkt[3] = (advertised >> 8) & 0xFF;
+  pkt[4] = advertised & 0xFF;
+  pkt[5] = sack.size() & 0xFF;
+  if (echo) {
+    for (uint32_t i = 0; i < TS_OPTION; i++)
+      pkt[ACK_HEADER + i] = (tsEcr >> (8 * (TS_OPTION - 1 - i))) & 0xFF;
+  }
+  std::copy(sack.begin(), sack.end(), pkt.begin() + header);
+  pkt[ACK_HEADER - 1] = Codec::check(pkt, ACK_HEADER, pkt.size());
   return pkt;
 }
 
-uint32_t MyProtocol::parseSeq(const std::vector<int32_t> &pkt) {
-  return ((pkt[1] & 0xFF) << 8) | (pkt[2] & 0xFF);
+// Rewrites the timestamp option of an already built data packet, so every
+// transmission of a segment carries the time it actually left.
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::stampTimestamp(
+    framework::Packet &pkt, uint32_t tsVal) {
+  if (!hasTimestamp(pkt, DATA_HEADER))
+    return;
+  for (uint32_t i = 0; i < TS_OPTION; i++)
+    pkt[DATA_HEADER + i] = (tsVal >> (8 * (TS_OPTION - 1 - i))) & 0xFF;
+  pkt[DATA_HEADER - 1] =
+      Codec::check(pkt, DATA_HEADER, DATA_HEADER + TS_OPTION);
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+framework::Packet
+BasicProtocol<Window, Ack, Codec, Recovery, Mode>::buildHelloPacket() {
+  framework::Packet pkt(HELLO_LEN);
+  pkt[0] = TYPE_HELLO;
+  pkt[1] = (identity.totalPkts >> 8) & 0xFF;
+  pkt[2] = identity.totalPkts & 0xFF;
+  for (uint32_t i = 0; i < 4; i++) {
+    pkt[3 + i] = (identity.size >> (8 * (3 - i))) & 0xFF;
+    pkt[7 + i] = (identity.crc >> (8 * (3 - i))) & 0xFF;
+  }
+  pkt[HELLO_LEN - 1] = Codec::check(pkt, HELLO_LEN, HELLO_LEN);
+  return pkt;
+}
+
+// One packet per SIGS_PER_PACKET basis blocks, each naming the block count
+// so the sender knows when it has them all; a single empty one if there is
+// no basis.
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::buildSigPackets(
+    std::vector<framework::Packet> &out) {
+  uint32_t blocks = (uint32_t)std::min<size_t>(basisSigs.size(), 0xFFFF);
+  uint32_t first = 0;
+  do {
+    uint32_t count = std::min<uint32_t>(blocks - first, SIGS_PER_PACKET);
+    framework::Packet pkt(SIG_HEADER);
+    pkt[0] = TYPE_SIGS;
+    pkt[1] = (blocks >> 8) & 0xFF;
+    pkt[2] = blocks & 0xFF;
+    pkt[3] = (first >> 8) & 0xFF;
+    pkt[4] = first & 0xFF;
+    pkt[5] = count;
+    for (uint32_t i = first; i < first + count; i++) {
+      for (int k = 3; k >= 0; k--)
+        pkt.push_back((basisSigs[i].weak >> (8 * k)) & 0xFF);
+      for (int k = 7; k >= 0; k--)
+        pkt.push_back((basisSigs[i].strong >> (8 * k)) & 0xFF);
+    }
+    pkt[SIG_HEADER - 1] = Codec::check(pkt, SIG_HEADER, pkt.size());
+    out.push_back(pkt);
+    first += count;
+  } while (first < blocks);
+}
+
+// Packs ascending seqs into runs of consecutive ones, RANGES_PER_PACKET
+// runs per packet; a single packet without ranges still carries the ack
+// base, window and rate.
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::buildRangePackets(
+    uint32_t type, uint32_t ackBase, uint16_t advertised, uint16_t ratePps,
+    const std::vector<uint32_t> &seqs,
+    std::vector<framework::Packet> &out) {
+  size_t i = 0;
+  do {
+    framework::Packet pkt(RANGE_HEADER);
+    pkt.reserve(MAX_PACKET);
+    pkt[0] = type;
+    pkt[1] = (ackBase >> 8) & 0xFF;
+    pkt[2] = ackBase & 0xFF;
+    pkt[3] = (advertised >> 8) & 0xFF;
+    pkt[4] = advertised & 0xFF;
+    pkt[5] = (ratePps >> 8) & 0xFF;
+    pkt[6] = ratePps & 0xFF;
+    uint32_t ranges = 0;
+    while (i < seqs.size() && ranges < RANGES_PER_PACKET) {
+      uint32_t first = seqs[i];
+      uint32_t count = 1;
+      while (i + count < seqs.size() && count < 0xFF &&
+             seqs[i + count] == first + count)
+        count++;
+      pkt.push_back((first >> 8) & 0xFF);
+      pkt.push_back(first & 0xFF);
+      pkt.push_back(count);
+      ranges++;
+      i += count;
+    }
+    pkt[7] = ranges;
+    pkt[RANGE_HEADER - 1] = Codec::check(pkt, RANGE_HEADER, pkt.size());
+    out.push_back(pkt);
+  } while (i < seqs.size());
+}
+
+// Answers a HELLO with one bitmap per RESUME_BITS segments that holds
+// anything, or a single empty one, so the sender stops repeating HELLO.
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::buildResumePackets(
+    std::vector<framework::Packet> &out) {
+  for (uint32_t first = 0; first < identity.totalPkts; first += RESUME_BITS) {
+    uint32_t end = std::min(first + RESUME_BITS, identity.totalPkts);
+    framework::Packet pkt(RESUME_HEADER, 0);
+    bool any = false;
+    for (uint32_t seq = first; seq < end; seq++) {
+      uint32_t bit = seq - first;
+      if (bit % 8 == 0)
+        pkt.push_back(0);
+      if (store.has(seq)) {
+        pkt.back() |= 1U << (bit % 8);
+        any = true;
+      }
+    }
+    if (!any)
+      continue;
+    pkt[0] = TYPE_RESUME;
+    pkt[1] = (first >> 8) & 0xFF;
+    pkt[2] = first & 0xFF;
+    pkt[3] = (pkt.size() - RESUME_HEADER) & 0xFF;
+    pkt[RESUME_HEADER - 1] = Codec::check(pkt, RESUME_HEADER, pkt.size());
+    out.push_back(pkt);
+  }
+  if (out.empty()) {
+    framework::Packet pkt(RESUME_HEADER, 0);
+    pkt[0] = TYPE_RESUME;
+    pkt[RESUME_HEADER - 1] = Codec::check(pkt, RESUME_HEADER, pkt.size());
+    out.push_back(pkt);
+  }
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+bool BasicProtocol<Window, Ack, Codec, Recovery, Mode>::parseHello(
+    const framework::Packet &pkt, FileIdentity &out) {
+  if (pkt.size() != HELLO_LEN ||
+      pkt[HELLO_LEN - 1] != Codec::check(pkt, HELLO_LEN, HELLO_LEN))
+    return false;
+  out.totalPkts = (pkt[1] << 8) | pkt[2];
+  out.size = 0;
+  out.crc = 0;
+  for (uint32_t i = 0; i < 4; i++) {
+    out.size = (out.size << 8) | pkt[3 + i];
+    out.crc = (out.crc << 8) | pkt[7 + i];
+  }
+  out.segmentSize = DATASIZE;
+  return out.totalPkts > 0 &&
+         (uint64_t)(out.totalPkts - 1) * out.segmentSize <= out.size &&
+         out.size <= (uint64_t)out.totalPkts * out.segmentSize;
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+uint32_t
+BasicProtocol<Window, Ack, Codec, Recovery, Mode>::parseSeq(
+    const framework::Packet &pkt) {
+  return (pkt[1] << 8) | pkt[2];
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+uint32_t BasicProtocol<Window, Ack, Codec, Recovery, Mode>::parseTotalPkts(
+    const framework::Packet &pkt) {
+  return (pkt[3] << 8) | pkt[4];
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+uint32_t BasicProtocol<Window, Ack, Codec, Recovery, Mode>::parseTimestamp(
+    const framework::Packet &pkt, uint32_t header) {
+  uint32_t ts = 0;
+  for (uint32_t i = 0; i < TS_OPTION; i++)
+    ts = (ts << 8) | pkt[header + i];
+  return ts;
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+bool BasicProtocol<Window, Ack, Codec, Recovery, Mode>::hasTimestamp(
+    const framework::Packet &pkt, uint32_t header) {
+  return (pkt[0] & FLAG_TS) && pkt.size() >= header + TS_OPTION;
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+bool BasicProtocol<Window, Ack, Codec, Recovery, Mode>::verifyDataChecksum(
+    const framework::Packet &pkt) {
+  bool ts = (pkt[0] & FLAG_TS) != 0;
+  if (ts && !hasTimestamp(pkt, DATA_HEADER))
+    return false;
+  uint32_t header = DATA_HEADER + (ts ? (uint32_t)TS_OPTION : 0U);
+  return pkt[DATA_HEADER - 1] == Codec::check(pkt, DATA_HEADER, header);
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+bool BasicProtocol<Window, Ack, Codec, Recovery, Mode>::verifyAckChecksum(
+    const framework::Packet &pkt) {
+  uint32_t header =
+      ACK_HEADER + ((pkt[0] & FLAG_TS) ? (uint32_t)TS_OPTION : 0U);
+  if (pkt.size() != header + pkt[5])
+    return false;
+  return pkt[ACK_HEADER - 1] ==
+         Codec::check(pkt, ACK_HEADER, pkt.size());
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::updateRtt(
+    int64_t sampleUs) {
+  if (rttSamples == 0) {
+    srttUs = sampleUs;
+    rttvarUs = sampleUs / 2;
+  } else {
+    int64_t err = sampleUs - srttUs;
+    srttUs += err / 8;
+    rttvarUs += ((err < 0 ? -err : err) - rttvarUs) / 4;
+  }
+  rttSamples++;
+  metrics.rttUs.record((uint64_t)sampleUs);
+  if (minRttUs == 0 || sampleUs < minRttUs)
+    minRttUs = sampleUs;
+  window.onRttSample(sampleUs);
+  rtoMs = (srttUs + 4 * rttvarUs) / 1000;
+  if (rtoMs < MIN_RTO_MS)
+    rtoMs = MIN_RTO_MS;
+  if (rtoMs > MAX_RTO_MS)
+    rtoMs = MAX_RTO_MS;
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+BasicProtocol<Window, Ack, Codec, Recovery, Mode>::BasicProtocol() {
+  this->networkLayer = nullptr;
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+BasicProtocol<Window, Ack, Codec, Recovery, Mode>::~BasicProtocol() {}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::setStop() {
+  this->stop = true;
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::flushOutbox() {
+  if (outbox.empty())
+    return;
+  metrics.packetsSent.add(outbox.size());
+  networkLayer->sendPackets(&outbox);
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::countRetransmit(
+    uint32_t seq) {
+  retransmits++;
+  metrics.retransmits.add();
+  framework::trace(framework::TRACE_RETRANSMIT, seq, window.getCwnd());
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::setReceiveBufferBytes(
+    size_t bytes) {
+  recvBufferBytes = bytes;
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+const ReceiveBufferStats &
+BasicProtocol<Window, Ack, Codec, Recovery, Mode>::getReceiveBufferStats()
+    const {
+  return recvStats;
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+const OneWayDelayStats &
+BasicProtocol<Window, Ack, Codec, Recovery, Mode>::getOneWayDelayStats() const {
+  return delayStats;
+}
+
+// Marks seq acknowledged; returns whether that is news to the sender.
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+bool BasicProtocol<Window, Ack, Codec, Recovery, Mode>::markAcked(uint32_t seq,
+                                                            int64_t nowU) {
+  if (acked[seq])
+    return false;
+  acked[seq] = true;
+  // Under HARQ, an ack this soon after a round was earned by an earlier
+  // repair, and would make everything sent since look lost.
+  if (!HARQ_MODE || nowU - sentTimeUs[seq] >= minRttUs)
+    rackSentUs = std::max(rackSentUs, sentTimeUs[seq]);
+  newlyDelivered++;
+  window.onDelivered(seq);
+  return true;
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::handleAck(
+    const framework::Packet &pkt, int64_t nowU) {
+  if (pkt.size() < ACK_HEADER || (pkt[0] & TYPE_MASK) != TYPE_ACK)
+    return;
+  if (!verifyAckChecksum(pkt)) {
+    metrics.checksumFailed.add();
+    return;
+  }
+  metrics.acksReceived.add();
+
+  // The echo names the exact transmission being acknowledged, so even
+  // ACKs for retransmitted segments give an unambiguous sample.
+  if (hasTimestamp(pkt, ACK_HEADER)) {
+    uint32_t elapsed = (uint32_t)nowU - parseTimestamp(pkt, ACK_HEADER);
+    if (elapsed < (uint32_t)MAX_RTO_MS * 1000)
+      updateRtt(elapsed);
+  }
+
+  uint32_t ab = (pkt[1] << 8) | pkt[2];
+  if (ab > totalPkts)
+    return;
+  // An ack base past nextSeq is only credible if the receiver resumed
+  // everything in between from an earlier run.
+  for (uint32_t s = nextSeq; s < ab; s++) {
+    if (!acked[s])
+      return;
+  }
+  nextSeq = std::max(nextSeq, ab);
+
+  rwnd = (pkt[3] << 8) | pkt[4];
+  framework::trace(framework::TRACE_ACK_RECEIVED, ab, rwnd);
+
+  while (sendBase < ab) {
+    // Resumed segments were never sent, so they say nothing about loss.
+    if (FEC_MODE && sentTimeUs[sendBase] != 0)
+      fecPlanner.onOutcome(holeSeen[sendBase]);
+    markAcked(sendBase, nowU);
+    sendBase++;
+  }
+
+  // The bitmap covers every buffered segment past the ack base, so the
+  // scoreboard is complete and RACK never mistakes a hole for a loss.
+  uint32_t sackAt =
+      ACK_HEADER + ((pkt[0] & FLAG_TS) ? (uint32_t)TS_OPTION : 0U);
+  uint32_t sacked = 0;
+  uint32_t sackEnd = ab + 1;
+  for (size_t j = sackAt; j < pkt.size(); j++) {
+    uint32_t bits = pkt[j];
+    for (uint32_t i = 0; bits != 0; i++, bits >>= 1) {
+      uint32_t s = ab + 1 + (uint32_t)(j - sackAt) * 8 + i;
+      if (!(bits & 1U))
+        continue;
+      sacked++;
+      sackEnd = s + 1;
+      if (s < nextSeq && markAcked(s, nowU))
+        metrics.sackRecovered.add();
+    }
+  }
+  if (sacked != 0)
+    framework::trace(framework::TRACE_SACK_GAP, ab, sackEnd - ab - sacked);
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::handleResume(
+    const framework::Packet &pkt) {
+  if (pkt.size() < RESUME_HEADER ||
+      pkt.size() != RESUME_HEADER + (uint32_t)pkt[3] ||
+      pkt[RESUME_HEADER - 1] !=
+          Codec::check(pkt, RESUME_HEADER, pkt.size()))
+    return;
+  helloAnswered = true;
+
+  // The receiver only offers segments of a file with our identity, so
+  // these count as delivered without telling the window; they were never
+  // in flight.
+  uint32_t first = (pkt[1] << 8) | pkt[2];
+  for (size_t j = RESUME_HEADER; j < pkt.size(); j++) {
+    uint32_t bits = pkt[j];
+    for (uint32_t i = 0; bits != 0; i++, bits >>= 1) {
+      uint32_t seq = first + (uint32_t)(j - RESUME_HEADER) * 8 + i;
+      if ((bits & 1U) && seq < totalPkts && !acked[seq]) {
+        acked[seq] = true;
+        resumedSegments++;
+      }
+    }
+  }
+}
+
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+bool BasicProtocol<Window, Ack, Codec, Recovery, Mode>::verifyRangePacket(
+    const framework::Packet &pkt) {
+  return pkt.size() >= RANGE_HEADER &&
+         pkt.size() == RANGE_HEADER + (uint32_t)pkt[7] * RANGE_ENTRY &&
+         pkt[RANGE_HEADER - 1] ==
+             Codec::check(pkt, RANGE_HEADER, pkt.size());
+}
+
+// Sends exactly what the receiver asked for, a segment asked for twice
+// included: the receiver alone decides what is lost.
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::handlePull(
+    const framework::Packet &pkt, int64_t nowU) {
+  if (!verifyRangePacket(pkt))
+    return;
+  uint32_t ab = (pkt[1] << 8) | pkt[2];
+  while (sendBase < ab && sendBase < totalPkts)
+    acked[sendBase++] = true;
+
+  for (size_t at = RANGE_HEADER; at < pkt.size(); at += RANGE_ENTRY) {
+    uint32_t first = (pkt[at] << 8) | pkt[at + 1];
+    uint32_t end = std::min(first + pkt[at + 2], totalPkts);
+    for (uint32_t seq = std::max(first, sendBase); seq < end; seq++) {
+      if (sentTimeUs[seq] != 0)
+        countRetransmit(seq);
+      else
+        framework::trace(framework::TRACE_PACKET_SENT, seq, 0);
+      stampTimestamp(packetBuffer[seq], (uint32_t)nowU);
+      outbox.push_back(packetBuffer[seq]);
+      sentTimeUs[seq] = nowU;
+      pullServed++;
+    }
+  }
+}
+
+// Every NACK doubles as a heartbeat: ack base, window and the rate to pace
+// at. Named segments that were sent and are not behind the ack base go out
+// again at once, ahead of new data.
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::handleNack(
+    const framework::Packet &pkt, int64_t nowU) {
+  if (!verifyRangePacket(pkt))
+    return;
+  uint32_t ab = (pkt[1] << 8) | pkt[2];
+  while (sendBase < ab && sendBase < totalPkts)
+    acked[sendBase++] = true;
+  nextSeq = std::max(nextSeq, sendBase);
+  rwnd = (pkt[3] << 8) | pkt[4];
+  uint32_t ratePps = (pkt[5] << 8) | pkt[6];
+  if (ratePps > 0)
+    nackRatePps = ratePps;
+
+  for (size_t at = RANGE_HEADER; at < pkt.size(); at += RANGE_ENTRY) {
+    uint32_t first = (pkt[at] << 8) | pkt[at + 1];
+    uint32_t end = std::min(first + pkt[at + 2], nextSeq);
+    for (uint32_t seq = std::max(first, sendBase); seq < end; seq++) {
+      if (acked[seq])
+        continue;
+      stampTimestamp(packetBuffer[seq], (uint32_t)nowU);
+      outbox.push_back(packetBuffer[seq]);
+      sentTimeUs[seq] = nowU;
+      countRetransmit(seq);
+    }
+  }
+}
+
+// Token bucket at the advised rate, bursting at most a few packets after
+// an idle spell, like AdaptiveWindow's pacer.
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+bool BasicProtocol<Window, Ack, Codec, Recovery, Mode>::nackPaceAllows(
+    int64_t nowU) {
+  int64_t intervalUs = (int64_t)(1e6 / nackRatePps);
+  int64_t floor = nowU - 4 * intervalUs;
+  if (nackNextSendUs < floor)
+    nackNextSendUs = floor;
+  if (nackNextSendUs > nowU)
+    return false;
+  nackNextSendUs += intervalUs;
+  return true;
+}
+
+// Plans FEC for the frame starting at first. Members of protected blocks
+// are held back from loss detection until their block's repairs are out.
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::startFrame(
+    uint32_t first) {
+  framePlan = fecPlanner.plan();
+  frameFirst = first;
+  frameEnd = std::min(first + framePlan.blockSize * framePlan.depth,
+                      totalPkts);
+  if (framePlan.parity == 0)
+    return;
+  for (uint32_t seq = first; seq < frameEnd; seq++)
+    fecGuardUs[seq] = -1;
+}
+
+// Queues the repairs of seq's block once seq is the block's last member.
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::queueRepairs(
+    uint32_t seq) {
+  if (framePlan.parity == 0 || seq + framePlan.depth < frameEnd)
+    return;
+  uint32_t first = frameFirst + (seq - frameFirst) % framePlan.depth;
+  uint32_t count = (frameEnd - first + framePlan.depth - 1) / framePlan.depth;
+  for (uint32_t i = 0; i < framePlan.parity; i++) {
+    RepairJob job = {first, framePlan.depth, count, i, (1U << count) - 1,
+                     i + 1 == framePlan.parity};
+    repairQueue.push_back(job);
+  }
+}
+
+// Repair payloads are always DATASIZE bytes: a short final segment counts
+// as zero-padded, and tailLen tells the receiver where to cut it.
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+framework::Packet
+BasicProtocol<Window, Ack, Codec, Recovery, Mode>::buildRepairPacket(
+    const RepairJob &job) {
+  uint32_t offset = DATA_HEADER + (USE_TIMESTAMPS ? (uint32_t)TS_OPTION : 0U);
+  std::vector<uint8_t> &sum = repairSum;
+  std::vector<uint8_t> &source = repairSource;
+  sum.assign(DATASIZE, 0);
+  source.resize(DATASIZE);
+  for (uint32_t i = 0; i < job.count; i++) {
+    if (!(job.mask & (1U << i)))
+      continue;
+    const framework::Packet &data = packetBuffer[job.first + i * job.stride];
+    std::fill(source.begin(), source.end(), 0);
+    std::copy(data.begin() + offset, data.end(), source.begin());
+    ErasureCode::addScaled(sum.data(), source.data(),
+                           ErasureCode::coefficient(job.index, i), DATASIZE);
+  }
+
+  framework::Packet pkt(REPAIR_HEADER + DATASIZE);
+  pkt[0] = TYPE_REPAIR;
+  pkt[1] = (job.first >> 8) & 0xFF;
+  pkt[2] = job.first & 0xFF;
+  pkt[3] = job.stride;
+  pkt[4] = job.count;
+  pkt[5] = job.index;
+  pkt[6] = (job.mask >> 8) & 0xFF;
+  pkt[7] = job.mask & 0xFF;
+  pkt[8] = (packetBuffer[totalPkts - 1].size() - offset) & 0xFF;
+  pkt[REPAIR_HEADER - 1] = Codec::check(pkt, REPAIR_HEADER, REPAIR_HEADER);
+  std::copy(sum.begin(), sum.end(), pkt.begin() + REPAIR_HEADER);
+  return pkt;
 }
 
-uint32_t MyProtocol::parseTotalPkts(const std::vector<int32_t> &pkt) {
-  return ((pkt[3] & 0xFF) << 8) | (pkt[4] & 0xFF);
+// One retransmission round. lost is ascending, so each block's losses are
+// consecutive in it. A block gets one new repair per loss, each coded over
+// all its outstanding holes: earlier rounds' repairs still count at the
+// receiver, and a new one stands in for any of them that got lost. A block
+// still being sent, or out of repair indices, gets plain copies instead.
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::sendHarqRepairs(
+    const std::vector<uint32_t> &lost, int64_t nowU) {
+  uint32_t blockSize = REPAIR_SOURCES;
+  size_t i = 0;
+  while (i < lost.size()) {
+    uint32_t block = lost[i] / REPAIR_SOURCES;
+    size_t end = i;
+    while (end < lost.size() && lost[end] / REPAIR_SOURCES == block)
+      end++;
+    uint32_t first = block * REPAIR_SOURCES;
+    uint32_t count = std::min(blockSize, totalPkts - first);
+    uint32_t repairs = (uint32_t)(end - i);
+
+    if (first + count <= nextSeq &&
+        harqNextIndex[block] + repairs <= ErasureCode::MAX_REPAIRS) {
+      for (size_t k = i; k < end; k++)
+        harqOutstanding[lost[k]] = true;
+      uint32_t mask = 0;
+      for (uint32_t m = 0; m < count; m++) {
+        if (harqOutstanding[first + m] && !acked[first + m])
+          mask |= 1U << m;
+      }
+      for (uint32_t k = 0; k < repairs; k++) {
+        RepairJob job = {first, 1, count, harqNextIndex[block]++, mask, false};
+        outbox.push_back(buildRepairPacket(job));
+        repairsSent++;
+      }
+    } else {
+      for (size_t k = i; k < end; k++) {
+        stampTimestamp(packetBuffer[lost[k]], (uint32_t)nowU);
+        outbox.push_back(packetBuffer[lost[k]]);
+      }
+    }
+    for (size_t k = i; k < end; k++) {
+      sentTimeUs[lost[k]] = nowU;
+      countRetransmit(lost[k]);
+    }
+    i = end;
+  }
 }
 
-bool MyProtocol::verifyDataChecksum(const std::vector<int32_t> &pkt) {
-  uint8_t expected = (pkt[1] ^ pkt[2] ^ pkt[3] ^ pkt[4]) & 0xFF;
-  return (pkt[5] & 0xFF) == expected;
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::setIdentity(
+    const std::vector<int32_t> &contents) {
+  std::vector<uint8_t> bytes(contents.begin(), contents.end());
+  identity.size = (uint32_t)contents.size();
+  identity.crc = crc32_fast(bytes.data(), bytes.size(), 0);
+  identity.totalPkts = std::max<uint32_t>((identity.size + DATASIZE - 1) /
+                                              DATASIZE,
+                                          1);
+  identity.segmentSize = DATASIZE;
 }
 
-bool MyProtocol::verifyAckChecksum(const std::vector<int32_t> &pkt) {
-  uint8_t expected = (pkt[1] ^ pkt[2] ^ pkt[3] ^ pkt[4]) & 0xFF;
-  return (pkt[5] & 0xFF) == expected;
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::handleSigs(
+    const framework::Packet &pkt) {
+  if (pkt.size() < SIG_HEADER ||
+      pkt.size() != SIG_HEADER + (uint32_t)pkt[5] * SIG_ENTRY ||
+      pkt[SIG_HEADER - 1] !=
+          Codec::check(pkt, SIG_HEADER, pkt.size()))
+    return;
+  uint32_t blocks = (pkt[1] << 8) | pkt[2];
+  uint32_t first = (pkt[3] << 8) | pkt[4];
+  if (!sigsAnnounced) {
+    basisSigs.assign(blocks, BlockSignature());
+    sigsAnnounced = true;
+  }
+  if (blocks != basisSigs.size())
+    return;
+
+  for (uint32_t i = 0; i < (uint32_t)pkt[5]; i++) {
+    uint32_t block = first + i;
+    if (block >= blocks || basisSigs[block].valid)
+      continue;
+    size_t at = SIG_HEADER + (size_t)i * SIG_ENTRY;
+    BlockSignature &sig = basisSigs[block];
+    for (uint32_t k = 0; k < 4; k++)
+      sig.weak = (sig.weak << 8) | pkt[at + k];
+    for (uint32_t k = 4; k < SIG_ENTRY; k++)
+      sig.strong = (sig.strong << 8) | pkt[at + k];
+    sig.valid = true;
+    sigsReceived++;
+  }
 }
 
-MyProtocol::MyProtocol() { this->networkLayer = nullptr; }
+// Asks for the receiver's basis signatures and encodes target against
+// them. Each HELLO is answered with the whole set, so one that comes back
+// incomplete is repeated a round trip later; blocks whose signature never
+// arrives are simply sent literally.
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+std::vector<int32_t>
+BasicProtocol<Window, Ack, Codec, Recovery, Mode>::negotiateDelta(
+    const std::vector<int32_t> &target) {
+  setIdentity(target);
+  basisSigs.clear();
+  sigsReceived = 0;
+  sigsAnnounced = false;
 
-MyProtocol::~MyProtocol() {}
+  int tries = 0;
+  int64_t helloUs = 0;
+  int64_t rttUs = 0; // HELLO to first signatures
+  while (!stop) {
+    int64_t nowU = nowUs();
+    if (sigsAnnounced && sigsReceived == basisSigs.size())
+      break;
+    int64_t waitUs = rttUs > 0 ? 2 * rttUs : TIMEOUT_MS * 1000;
+    if (nowU - helloUs > waitUs) {
+      if (tries++ == DELTA_HELLO_TRIES)
+        break;
+      networkLayer->sendPacket(buildHelloPacket());
+      helloUs = nowU;
+    }
+
+    inbox.clear();
+    networkLayer->receivePackets(&inbox);
+    for (const framework::Packet &pkt : inbox) {
+      if (!pkt.empty() && (pkt[0] & TYPE_MASK) == TYPE_SIGS) {
+        handleSigs(pkt);
+        if (rttUs == 0)
+          rttUs = std::max<int64_t>(nowU - helloUs, 1);
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
 
-void MyProtocol::setStop() { this->stop = true; }
+  uint32_t matched = 0;
+  std::vector<int32_t> stream = DeltaCodec::encode(target, basisSigs, &matched);
+  std::cout << "Delta: " << matched << " blocks copied from "
+            << basisSigs.size() << " in the basis (" << sigsReceived
+            << " signatures received); " << stream.size()
+            << " bytes to send for " << target.size() << "." << std::endl;
+  return stream;
+}
 
-void MyProtocol::sender() {
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::sender() {
+  framework::PhaseTimer phase(metrics.sendTime);
   std::cout << "Sending..." << std::endl;
 
   std::vector<int32_t> fileContents = framework::getFileContents(fileID);
+  if (DELTA_MODE)
+    fileContents = negotiateDelta(fileContents);
   uint32_t fileSize = (uint32_t)fileContents.size();
 
   totalPkts = (fileSize + DATASIZE - 1) / DATASIZE;
@@ -97,7 +784,16 @@ void MyProtocol::sender() {
 
   packetBuffer.resize(totalPkts);
   acked.resize(totalPkts, false);
-  sentTime.resize(totalPkts, 0);
+  sentTimeUs.resize(totalPkts, 0);
+  if (FEC_MODE) {
+    fecGuardUs.assign(totalPkts, 0);
+    holeSeen.assign(totalPkts, false);
+    frameFirst = frameEnd = 0;
+  }
+  if (HARQ_MODE) {
+    harqNextIndex.assign((totalPkts + REPAIR_SOURCES - 1) / REPAIR_SOURCES, 0);
+    harqOutstanding.assign(totalPkts, false);
+  }
 
   for (uint32_t i = 0; i < totalPkts; i++) {
     uint32_t off = i * DATASIZE;
@@ -107,151 +803,845 @@ void MyProtocol::sender() {
 
   sendBase = 0;
   nextSeq = 0;
+  helloAnswered = DELTA_MODE;
+  helloSentUs = nowUs();
+  if (!DELTA_MODE) {
+    setIdentity(fileContents);
+    outbox.push_back(buildHelloPacket());
+  }
+  window.start(totalPkts, helloSentUs);
+
+  // Pull mode's unscheduled burst, sent blind so the first round trip is
+  // not spent waiting for requests. It is kept short, since segments only
+  // give the receiver RTT samples once it has requested them.
+  if (PULL_MODE) {
+    for (; nextSeq < totalPkts && nextSeq < PULL_BURST; nextSeq++) {
+      stampTimestamp(packetBuffer[nextSeq], (uint32_t)helloSentUs);
+      outbox.push_back(packetBuffer[nextSeq]);
+      sentTimeUs[nextSeq] = helloSentUs;
+      framework::trace(framework::TRACE_PACKET_SENT, nextSeq, 0);
+    }
+  }
 
   while (!stop && sendBase < totalPkts) {
-    int64_t now = nowMs();
+    int64_t nowU = nowUs();
 
-    std::vector<int32_t> pkt;
-    while (networkLayer->receivePacket(&pkt)) {
-      if (pkt.size() < ACK_HEADER || (pkt[0] & 0xFF) != TYPE_ACK)
-        continue;
-      if (!verifyAckChecksum(pkt))
-        continue;
+    inbox.clear();
+    networkLayer->receivePackets(&inbox);
+    newlyDelivered = 0;
+    for (const framework::Packet &pkt : inbox) {
+      if (!pkt.empty() && (pkt[0] & TYPE_MASK) == TYPE_RESUME)
+        handleResume(pkt);
+      else if (PULL_MODE && !pkt.empty() && (pkt[0] & TYPE_MASK) == TYPE_PULL)
+        handlePull(pkt, nowU);
+      else if (NACK_MODE && !pkt.empty() && (pkt[0] & TYPE_MASK) == TYPE_NACK)
+        handleNack(pkt, nowU);
+      else
+        handleAck(pkt, nowU);
+    }
+    window.onAckBurst(newlyDelivered, nowU, srttUs, rtoMs * 1000);
 
-      uint32_t ab = ((pkt[1] & 0xFF) << 8) | (pkt[2] & 0xFF);
-      uint16_t sm = ((pkt[3] & 0xFF) << 8) | (pkt[4] & 0xFF);
+    if (sendBase >= totalPkts)
+      break;
 
-      if (ab > nextSeq || ab > totalPkts)
-        continue;
+    if (!helloAnswered && nowU - helloSentUs > rtoMs * 1000) {
+      outbox.push_back(buildHelloPacket());
+      helloSentUs = nowU;
+    }
 
-      while (sendBase < ab) {
-        acked[sendBase] = true;
-        sendBase++;
-      }
+    if (PULL_MODE) {
+      flushOutbox();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
 
-      for (uint32_t i = 0; i < SACK_BITS; i++) {
-        if ((sm >> i) & 1U) {
-          uint32_t s = ab + i;
-          if (s < nextSeq && s < totalPkts)
-            acked[s] = true;
+    // NACK mode has no ACK clock: stream at the advised rate, up to the
+    // receiver's window, and leave repair to handleNack.
+    if (NACK_MODE) {
+      uint32_t edge = sendBase + std::max(rwnd, 1U);
+      while (nextSeq < totalPkts && nextSeq < edge) {
+        if (acked[nextSeq]) { // resumed
+          nextSeq++;
+          continue;
         }
+        if (!nackPaceAllows(nowU))
+          break;
+        stampTimestamp(packetBuffer[nextSeq], (uint32_t)nowU);
+        outbox.push_back(packetBuffer[nextSeq]);
+        sentTimeUs[nextSeq] = nowU;
+        framework::trace(framework::TRACE_PACKET_SENT, nextSeq, 0);
+        nextSeq++;
       }
+      flushOutbox();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
     }
 
-    if (sendBase >= totalPkts)
-      break;
-
+    int64_t reoWndUs = minRttUs / 4;
     uint32_t inFlight = 0;
+    harqLost.clear();
     for (uint32_t i = sendBase; i < nextSeq && i < totalPkts; i++) {
-      if (!acked[i]) {
-        inFlight++;
-        if (sentTime[i] > 0 && (now - sentTime[i]) > TIMEOUT_MS) {
-          networkLayer->sendPacket(packetBuffer[i]);
-          sentTime[i] = now;
+      if (acked[i])
+        continue;
+      inFlight++;
+      // A protected segment is only lost once its block's repairs had
+      // their chance, so it is timed from the last of them.
+      int64_t sentUs = sentTimeUs[i];
+      if (FEC_MODE) {
+        if (sentUs + reoWndUs < rackSentUs)
+          holeSeen[i] = true;
+        if (fecGuardUs[i] < 0 && nowU - sentUs <= rtoMs * 1000)
+          continue;
+        sentUs = std::max(sentUs, fecGuardUs[i]);
+      }
+      if (Recovery::isLost(sentUs, rackSentUs, reoWndUs, nowU,
+                           rtoMs * 1000)) {
+        if (nowU - sentUs > rtoMs * 1000)
+          framework::trace(framework::TRACE_TIMEOUT, i, (uint32_t)rtoMs);
+        else
+          framework::trace(framework::TRACE_PACKET_LOST, i, window.getCwnd());
+        window.onLoss(i, nextSeq);
+        if (FEC_MODE) {
+          holeSeen[i] = true;
+          fecGuardUs[i] = 0;
         }
+        if (HARQ_MODE) {
+          harqLost.push_back(i);
+          continue;
+        }
+        stampTimestamp(packetBuffer[i], (uint32_t)nowU);
+        outbox.push_back(packetBuffer[i]);
+        sentTimeUs[i] = nowU;
+        countRetransmit(i);
       }
     }
+    if (!harqLost.empty())
+      sendHarqRepairs(harqLost, nowU);
 
-    while (nextSeq < totalPkts && inFlight < WINDOW) {
-      networkLayer->sendPacket(packetBuffer[nextSeq]);
-      sentTime[nextSeq] = now;
+    // Repairs are paced with the data but not counted in flight: they are
+    // never acknowledged or retransmitted.
+    while (!repairQueue.empty() && window.paceAllows(nowU)) {
+      const RepairJob &job = repairQueue.front();
+      outbox.push_back(buildRepairPacket(job));
+      repairsSent++;
+      if (job.last) {
+        for (uint32_t k = 0; k < job.count; k++) {
+          uint32_t seq = job.first + k * job.stride;
+          if (fecGuardUs[seq] < 0)
+            fecGuardUs[seq] = nowU;
+        }
+      }
+      repairQueue.pop_front();
+    }
+
+    // The receiver only buffers up to rwnd segments past its ack base, so
+    // never send beyond that edge, whatever the congestion window allows.
+    uint32_t edge = sendBase + std::max(rwnd, 1U);
+    uint32_t cwnd = window.getCwnd();
+    if (cwnd != tracedCwnd) {
+      framework::trace(framework::TRACE_WINDOW, inFlight, cwnd);
+      tracedCwnd = cwnd;
+    }
+    while (nextSeq < totalPkts && nextSeq < edge && inFlight < cwnd &&
+           repairQueue.empty()) {
+      if (FEC_MODE && nextSeq >= frameEnd)
+        startFrame(nextSeq);
+      if (acked[nextSeq]) { // resumed
+        if (FEC_MODE)
+          queueRepairs(nextSeq);
+        nextSeq++;
+        continue;
+      }
+      if (!window.paceAllows(nowU))
+        break;
+      stampTimestamp(packetBuffer[nextSeq], (uint32_t)nowU);
+      outbox.push_back(packetBuffer[nextSeq]);
+      sentTimeUs[nextSeq] = nowU;
+      framework::trace(framework::TRACE_PACKET_SENT, nextSeq, cwnd);
+      if (FEC_MODE)
+        queueRepairs(nextSeq);
       nextSeq++;
       inFlight++;
     }
+    flushOutbox();
 
     std::this_thread::sleep_for(std::chrono::milliseconds(1));
   }
 
+  if (PULL_MODE)
+    std::cout << "Pull: " << pullServed << " segments sent on request, "
+              << retransmits << " of them again." << std::endl;
+  if (NACK_MODE)
+    std::cout << "NACK: " << retransmits << " segments repaired, last rate "
+              << (int)nackRatePps << " pkt/s." << std::endl;
+  if (FEC_MODE)
+    std::cout << "FEC: " << repairsSent << " repairs sent; loss "
+              << fecPlanner.getLossRate() * 100 << "%, mean burst "
+              << fecPlanner.getMeanBurst() << ", last plan " << framePlan.parity
+              << "/" << framePlan.blockSize << " at depth " << framePlan.depth
+              << "." << std::endl;
+  if (HARQ_MODE)
+    std::cout << "HARQ: " << repairsSent << " coded repairs sent for "
+              << retransmits << " lost segments." << std::endl;
+  std::cout << "RTT: srtt " << srttUs / 1000.0 << " ms, rto " << rtoMs
+            << " ms from " << rttSamples << " samples." << std::endl;
+  if (resumedSegments > 0)
+    std::cout << "Resumed: " << resumedSegments
+              << " segments already held by the receiver." << std::endl;
+  std::cout << "Losses: " << retransmits << " retransmits, "
+            << window.getLossStats().randomLosses << " random, "
+            << window.getLossStats().congestionLosses
+            << " congestion; final cwnd " << window.getCwnd() << std::endl;
   std::cout << "Sender finished." << std::endl;
 }
 
-std::vector<int32_t> MyProtocol::receiver() {
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+std::vector<int32_t>
+BasicProtocol<Window, Ack, Codec, Recovery, Mode>::receiver() {
+  framework::PhaseTimer phase(metrics.receiveTime);
   std::cout << "Receiving..." << std::endl;
 
   uint32_t expectedTotal = 0;
   uint32_t recvExpected = 0;
-  std::vector<std::vector<int32_t>> recvBuffer;
-  std::vector<bool> received;
+  std::vector<uint8_t> fileContents; // handed out as integers at the end
   int64_t lastRecvTime = nowMs();
-  std::vector<int32_t> lastAck;
+  framework::Packet lastAck; // without an echo, so keepalives don't skew RTT
+  bool haveEcho = false;
+  uint32_t echoTs = 0;
+  uint32_t highestOoo = 0;
+  std::vector<uint8_t> sack;
+  bool haveTransit = false;
+  int64_t lastTransitUs = 0;
+  int64_t minTransitUs = 0;
+  delayStats = OneWayDelayStats();
+
+  // Out-of-order segments live in a fixed ring of slots indexed by
+  // seq % capacity, covering [recvExpected, recvExpected + capacity). The
+  // ring is sized once from the memory budget and never grows.
+  uint32_t capacity = (uint32_t)std::min<size_t>(
+      std::max<size_t>(recvBufferBytes / DATASIZE, 1), 0xFFFF);
+  std::vector<uint8_t> slotData((size_t)capacity * DATASIZE);
+  std::vector<uint32_t> slotLen(capacity, 0);
+  std::vector<bool> slotFull(capacity, false);
+  recvStats = ReceiveBufferStats();
+  recvStats.capacity = capacity;
+
+  // Arrivals not yet acknowledged, and whether one of them must be
+  // acknowledged at once because it was out of order or filled a hole.
+  uint32_t pendingAcks = 0;
+  bool ackNow = false;
+  int64_t pendingSinceMs = 0;
+
+  // Moves whatever became contiguous to fileContents, freeing its slots.
+  // Segments recovered from an earlier run fill holes the ring cannot.
+  auto deliverContiguous = [&]() {
+    while (recvExpected < expectedTotal) {
+      uint32_t slot = recvExpected % capacity;
+      if (slotFull[slot]) {
+        std::vector<uint8_t>::const_iterator first =
+            slotData.begin() + (size_t)slot * DATASIZE;
+        fileContents.insert(fileContents.end(), first, first + slotLen[slot]);
+        slotFull[slot] = false;
+        recvStats.occupied--;
+      } else if (store.has(recvExpected)) {
+        store.appendTo(recvExpected, fileContents);
+      } else {
+        break;
+      }
+      recvExpected++;
+    }
+  };
+
+  // Files one segment's bytes, from the network or from an FEC decode.
+  auto place = [&](uint32_t seq, const uint8_t *first, const uint8_t *last) {
+    if (seq < recvExpected) {
+      recvStats.duplicates++;
+      metrics.duplicates.add();
+      framework::trace(framework::TRACE_DUPLICATE, seq, 0);
+    } else if (seq >= recvExpected + capacity) {
+      recvStats.beyondWindow++;
+    } else if (seq == recvExpected) {
+      fileContents.insert(fileContents.end(), first, last);
+      store.put(seq, first, last);
+      recvExpected++;
+    } else if (slotFull[seq % capacity] || store.has(seq)) {
+      recvStats.duplicates++;
+      metrics.duplicates.add();
+      framework::trace(framework::TRACE_DUPLICATE, seq, 0);
+    } else {
+      uint32_t slot = seq % capacity;
+      std::copy(first, last, slotData.begin() + (size_t)slot * DATASIZE);
+      store.put(seq, first, last);
+      slotLen[slot] = (uint32_t)(last - first);
+      slotFull[slot] = true;
+      highestOoo = std::max(highestOoo, seq);
+      recvStats.occupied++;
+      recvStats.peakOccupied =
+          std::max(recvStats.peakOccupied, recvStats.occupied);
+    }
+    deliverContiguous();
+  };
+
+  // Repairs per block, keyed by the block's first segment, until the block
+  // is decoded or filled by retransmissions.
+  struct RepairSet {
+    uint32_t stride;
+    uint32_t count;
+    uint32_t tailLen;
+    std::vector<uint32_t> index;
+    std::vector<uint32_t> mask;
+    std::vector<framework::Packet> payload;
+  };
+  std::map<uint32_t, RepairSet> repairSets;
+
+  auto held = [&](uint32_t seq) {
+    return seq < recvExpected ||
+           (seq < recvExpected + capacity && slotFull[seq % capacity]) ||
+           store.has(seq);
+  };
 
-  while (true) {
-    std::vector<int32_t> packet;
+  // A held segment's bytes, zero-padded to DATASIZE as the sender coded it.
+  auto segmentBytes = [&](uint32_t seq, std::vector<uint8_t> &out) {
+    if (seq < recvExpected) {
+      size_t at = (size_t)seq * DATASIZE;
+      size_t end = std::min(at + DATASIZE, fileContents.size());
+      out.assign(fileContents.begin() + at, fileContents.begin() + end);
+    } else if (seq < recvExpected + capacity && slotFull[seq % capacity]) {
+      std::vector<uint8_t>::const_iterator first =
+          slotData.begin() + (size_t)(seq % capacity) * DATASIZE;
+      out.assign(first, first + slotLen[seq % capacity]);
+    } else {
+      out.clear();
+      store.appendTo(seq, out);
+    }
+    out.resize(DATASIZE, 0);
+  };
 
-    if (networkLayer->receivePacket(&packet)) {
-      if (packet.size() < DATA_HEADER || (packet[0] & 0xFF) != TYPE_DATA)
+  // decodeBlock's working storage, kept across calls so that it is only
+  // allocated while growing.
+  std::vector<uint32_t> missing;
+  std::vector<std::vector<uint8_t>> residuals;
+  std::vector<std::vector<uint8_t>> rows;
+  std::vector<uint8_t> source;
+
+  // Solves for the missing members that some repair covers, once there
+  // are as many repairs as those; true once nothing is missing, so the
+  // repairs can go.
+  auto decodeBlock = [&](uint32_t first, RepairSet &set) {
+    uint32_t covered = 0;
+    for (uint32_t mask : set.mask)
+      covered |= mask;
+    missing.clear();
+    bool uncovered = false;
+    for (uint32_t i = 0; i < set.count; i++) {
+      if (held(first + i * set.stride))
         continue;
-      if (!verifyDataChecksum(packet))
+      if (covered & (1U << i))
+        missing.push_back(i);
+      else
+        uncovered = true;
+    }
+    if (missing.empty())
+      return !uncovered;
+    if (missing.size() > set.index.size())
+      return false;
+
+    residuals.resize(set.payload.size());
+    for (size_t r = 0; r < residuals.size(); r++)
+      residuals[r].assign(set.payload[r].begin(), set.payload[r].end());
+    for (uint32_t i = 0; i < set.count; i++) {
+      uint32_t seq = first + i * set.stride;
+      if (!(covered & (1U << i)) || !held(seq))
         continue;
+      segmentBytes(seq, source);
+      for (size_t r = 0; r < residuals.size(); r++) {
+        if (set.mask[r] & (1U << i))
+          ErasureCode::addScaled(residuals[r].data(), source.data(),
+                                 ErasureCode::coefficient(set.index[r], i),
+                                 DATASIZE);
+      }
+    }
+    rows.resize(set.index.size());
+    for (size_t r = 0; r < rows.size(); r++) {
+      rows[r].assign(missing.size(), 0);
+      for (size_t c = 0; c < missing.size(); c++) {
+        if (set.mask[r] & (1U << missing[c]))
+          rows[r][c] = ErasureCode::coefficient(set.index[r], missing[c]);
+      }
+    }
+    if (!ErasureCode::solve(rows, residuals))
+      return false;
+    for (size_t c = 0; c < missing.size(); c++) {
+      uint32_t seq = first + missing[c] * set.stride;
+      uint32_t len = seq + 1 == expectedTotal ? set.tailLen : DATASIZE;
+      place(seq, residuals[c].data(), residuals[c].data() + len);
+      fecRecovered++;
+    }
+    if (pendingAcks++ == 0)
+      pendingSinceMs = nowMs();
+    ackNow = true;
+    return !uncovered;
+  };
+
+  // The segments a PULL or NACK names, and the packets carrying them.
+  std::vector<uint32_t> rangeSeqs;
+  std::vector<framework::Packet> rangePackets;
+
+  int64_t lastFlushMs = nowMs();
+  int64_t lastFeedbackMs = 0;
+  bool basisLoaded = false;
+  bool done = false;
+  while (!done && !stop) {
+    inbox.clear();
+    size_t received = networkLayer->receivePackets(&inbox);
+    if (nowMs() - lastFlushMs >= STORE_FLUSH_MS) {
+      store.flush();
+      lastFlushMs = nowMs();
+    }
+    if (received == 0 && pendingAcks == 0 && !PULL_MODE && !NACK_MODE) {
+      int64_t now = nowMs();
+      if (!lastAck.empty() && (now - lastRecvTime) > ACK_KEEPALIVE_MS) {
+        networkLayer->sendPacket(lastAck);
+        metrics.acksSent.add();
+        framework::trace(framework::TRACE_ACK_SENT, recvExpected, capacity);
+        lastRecvTime = now;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+
+    // Take in the whole burst, then acknowledge it at most once.
+    for (const framework::Packet &packet : inbox) {
+      FileIdentity hello;
+      if (DELTA_MODE && !packet.empty() &&
+          (packet[0] & TYPE_MASK) == TYPE_HELLO) {
+        if (!parseHello(packet, hello))
+          continue;
+        if (!basisLoaded) {
+          basisLoaded = true;
+          std::string path = DeltaCodec::findLatestOutput(fileID);
+          if (!path.empty()) {
+            basis = DeltaCodec::readFile(path);
+            basisSigs = DeltaCodec::signatures(basis);
+            std::cout << "Delta basis: " << path << ", " << basisSigs.size()
+                      << " blocks." << std::endl;
+          }
+        }
+        std::vector<framework::Packet> sigs;
+        buildSigPackets(sigs);
+        networkLayer->sendPackets(&sigs);
+        continue;
+      }
+      if (!packet.empty() && (packet[0] & TYPE_MASK) == TYPE_HELLO &&
+          parseHello(packet, hello) &&
+          (expectedTotal == 0 || hello.totalPkts == expectedTotal)) {
+        if (!store.isOpen()) {
+          identity = hello;
+          std::string path = "rdtcResume" + fileID + ".part";
+          uint32_t recovered = store.open(path, identity);
+          if (recovered > 0)
+            std::cout << "Resuming with " << recovered << " segments from "
+                      << path << "." << std::endl;
+
+          // Whatever arrived ahead of the HELLO goes in the store too.
+          for (uint32_t seq = 0; seq < recvExpected; seq++) {
+            const uint8_t *first = fileContents.data() + (size_t)seq * DATASIZE;
+            store.put(seq, first, first + store.getLength(seq));
+          }
+          for (uint32_t seq = recvExpected + 1;
+               seq < expectedTotal && seq < recvExpected + capacity; seq++) {
+            uint32_t slot = seq % capacity;
+            if (!slotFull[slot])
+              continue;
+            const uint8_t *first = slotData.data() + (size_t)slot * DATASIZE;
+            store.put(seq, first, first + slotLen[slot]);
+          }
+
+          if (expectedTotal == 0) {
+            expectedTotal = identity.totalPkts;
+            fileContents.reserve((size_t)expectedTotal * DATASIZE);
+            std::cout << "Expecting " << expectedTotal << " packets."
+                      << std::endl;
+          }
+          highestOoo = std::max(highestOoo, store.getHighest());
+          deliverContiguous();
+        }
+        std::vector<framework::Packet> offer;
+        buildResumePackets(offer);
+        networkLayer->sendPackets(&offer);
+        if (pendingAcks++ == 0)
+          pendingSinceMs = nowMs();
+        ackNow = true;
+        continue;
+      }
+
+      if ((FEC_MODE || HARQ_MODE) &&
+          packet.size() == REPAIR_HEADER + DATASIZE &&
+          (packet[0] & TYPE_MASK) == TYPE_REPAIR) {
+        uint32_t first = (packet[1] << 8) | packet[2];
+        uint32_t stride = packet[3];
+        uint32_t count = packet[4];
+        uint32_t index = packet[5];
+        uint32_t mask = (packet[6] << 8) | packet[7];
+        if (packet[REPAIR_HEADER - 1] !=
+                Codec::check(packet, REPAIR_HEADER, REPAIR_HEADER) ||
+            expectedTotal == 0 || stride == 0 || count == 0 ||
+            count > REPAIR_SOURCES || mask == 0 || (mask >> count) != 0 ||
+            index >= ErasureCode::MAX_REPAIRS ||
+            first + (count - 1) * stride >= expectedTotal ||
+            first + (count - 1) * stride < recvExpected)
+          continue;
+        RepairSet &set = repairSets[first];
+        if (set.stride != stride || set.count != count) {
+          set = RepairSet();
+          set.stride = stride;
+          set.count = count;
+        }
+        set.tailLen = packet[8];
+        if (std::find(set.index.begin(), set.index.end(), index) !=
+            set.index.end())
+          continue;
+        set.index.push_back(index);
+        set.mask.push_back(mask);
+        set.payload.push_back(
+            framework::Packet(packet.begin() + REPAIR_HEADER, packet.end()));
+        continue;
+      }
+
+      if (packet.size() < DATA_HEADER || (packet[0] & TYPE_MASK) != TYPE_DATA)
+        continue;
+      if (!verifyDataChecksum(packet)) {
+        metrics.checksumFailed.add();
+        continue;
+      }
+      metrics.packetsReceived.add();
+
+      uint32_t header = DATA_HEADER;
+      int64_t queueingUs = 0;
+      if (hasTimestamp(packet, DATA_HEADER)) {
+        header += TS_OPTION;
+        echoTs = parseTimestamp(packet, DATA_HEADER);
+        haveEcho = true;
+
+        // Transit = arrival - departure, off by the unknown clock offset.
+        int64_t transitUs = (int32_t)((uint32_t)nowUs() - echoTs);
+        if (!haveTransit || transitUs < minTransitUs)
+          minTransitUs = transitUs;
+        if (haveTransit) {
+          int64_t d = transitUs - lastTransitUs;
+          delayStats.jitterUs += ((d < 0 ? -d : d) - delayStats.jitterUs) / 16;
+        }
+        queueingUs = transitUs - minTransitUs;
+        delayStats.maxQueueingUs =
+            std::max(delayStats.maxQueueingUs, queueingUs);
+        delayStats.samples++;
+        lastTransitUs = transitUs;
+        haveTransit = true;
+      }
 
       uint32_t seq = parseSeq(packet);
       uint32_t total = parseTotalPkts(packet);
+      framework::trace(framework::TRACE_DATA_RECEIVED, seq,
+                       (uint32_t)packet.size() - header);
+      if (PULL_MODE)
+        pull.onArrival(seq, nowUs());
+      if (NACK_MODE && nack.isStarted()) {
+        nack.onArrival(seq, echoTs, queueingUs, nowUs());
+        lastRecvTime = nowMs();
+      }
 
       if (expectedTotal == 0) {
         expectedTotal = total;
-        recvBuffer.resize(expectedTotal);
-        received.resize(expectedTotal, false);
+        fileContents.reserve((size_t)expectedTotal * DATASIZE);
         std::cout << "Expecting " << expectedTotal << " packets." << std::endl;
       }
 
       if (total != expectedTotal)
         continue;
 
-      if (seq < expectedTotal && !received[seq]) {
-        std::vector<int32_t> payload(packet.begin() + DATA_HEADER,
-                                     packet.end());
-        recvBuffer[seq] = payload;
-        received[seq] = true;
-      }
+      uint32_t len = (uint32_t)packet.size() - header;
+      if (seq >= expectedTotal || len > DATASIZE)
+        continue;
+      if (pendingAcks++ == 0)
+        pendingSinceMs = nowMs();
+      if (seq != recvExpected || recvStats.occupied > 0)
+        ackNow = true;
 
-      while (recvExpected < expectedTotal && received[recvExpected]) {
-        recvExpected++;
-      }
+      place(seq, packet.data() + header, packet.data() + packet.size());
+    }
 
-      uint16_t sackMask = 0;
-      for (uint32_t i = 0; i < SACK_BITS; i++) {
-        uint32_t checkSeq = recvExpected + i;
-        if (checkSeq < expectedTotal && received[checkSeq]) {
-          sackMask |= (1U << i);
-        }
-      }
+    for (typename std::map<uint32_t, RepairSet>::iterator it =
+             repairSets.begin();
+         it != repairSets.end();) {
+      if (decodeBlock(it->first, it->second))
+        it = repairSets.erase(it);
+      else
+        ++it;
+    }
 
-      lastAck = buildAckPacket(recvExpected, sackMask);
-      networkLayer->sendPacket(lastAck);
-      lastRecvTime = nowMs();
+    bool complete = expectedTotal > 0 && recvExpected >= expectedTotal;
 
-      if (recvExpected >= expectedTotal) {
+    // Pull mode replaces acknowledgements with requests for what is still
+    // missing inside the ring, so nothing arrives that has nowhere to go.
+    if (PULL_MODE) {
+      pendingAcks = 0;
+      ackNow = false;
+      if (expectedTotal == 0) {
+        if (received == 0)
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        continue;
+      }
+      if (!pull.isStarted())
+        pull.start(expectedTotal, PULL_BURST, capacity, nowUs());
+      rangeSeqs.clear();
+      if (!complete) {
+        pull.schedule(recvExpected, recvExpected + capacity, held, nowUs(),
+                      rangeSeqs);
+      }
+      if (!rangeSeqs.empty() || complete) {
+        buildRangePackets(TYPE_PULL, recvExpected, (uint16_t)capacity, 0,
+                          rangeSeqs, rangePackets);
+        metrics.acksSent.add(rangePackets.size());
+        framework::trace(framework::TRACE_ACK_SENT, recvExpected, capacity);
+        networkLayer->sendPackets(&rangePackets);
+      }
+      if (complete) {
         std::cout << "All " << expectedTotal << " packets received!"
                   << std::endl;
-        break;
+        store.discard();
+        done = true;
+      } else if (received == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
       }
-    } else {
-      int64_t now = nowMs();
-      if (!lastAck.empty() && (now - lastRecvTime) > ACK_KEEPALIVE_MS) {
-        networkLayer->sendPacket(lastAck);
-        lastRecvTime = now;
+      continue;
+    }
+
+    // NACK mode reports holes once reordering cannot explain them, and
+    // otherwise only sends a heartbeat every NACK_HEARTBEAT_MS. Until
+    // nothing has arrived for an RTO, a hole is only below the highest
+    // segment seen; after that, the tail counts too.
+    if (NACK_MODE) {
+      pendingAcks = 0;
+      ackNow = false;
+      if (expectedTotal == 0) {
+        if (received == 0)
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        continue;
       }
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      if (!nack.isStarted()) {
+        nack.start(expectedTotal);
+        lastRecvTime = nowMs();
+      }
+      rangeSeqs.clear();
+      if (!complete) {
+        uint32_t end = std::max(highestOoo + 1, recvExpected);
+        if ((nowMs() - lastRecvTime) * 1000 > nack.getRtoUs())
+          end = expectedTotal;
+        nack.collect(recvExpected, std::min(end, recvExpected + capacity),
+                     held, nowUs(), rangeSeqs);
+      }
+      if (!rangeSeqs.empty() || complete ||
+          nowMs() - lastFeedbackMs >= NACK_HEARTBEAT_MS) {
+        buildRangePackets(TYPE_NACK, recvExpected, (uint16_t)capacity,
+                          (uint16_t)nack.getAdvisedPps(), rangeSeqs,
+                          rangePackets);
+        metrics.acksSent.add(rangePackets.size());
+        framework::trace(framework::TRACE_ACK_SENT, recvExpected, capacity);
+        networkLayer->sendPackets(&rangePackets);
+        lastFeedbackMs = nowMs();
+      }
+      if (complete) {
+        std::cout << "All " << expectedTotal << " packets received!"
+                  << std::endl;
+        store.discard();
+        done = true;
+      } else if (received == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      continue;
     }
-  }
 
-  std::vector<int32_t> fileContents;
-  for (uint32_t i = 0; i < expectedTotal; i++) {
-    fileContents.insert(fileContents.end(), recvBuffer[i].begin(),
-                        recvBuffer[i].end());
+    if (pendingAcks == 0 ||
+        (!ackNow && !complete && pendingAcks < Ack::ACK_EVERY &&
+         nowMs() - pendingSinceMs < Ack::ACK_DELAY_MS)) {
+      if (received == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+
+    // One bit per segment after recvExpected, up to the highest one held.
+    sack.clear();
+    uint32_t sackEnd = std::min(highestOoo + 1, recvExpected + 1 + SACK_BITS);
+    for (uint32_t seq = recvExpected + 1; seq < sackEnd; seq++) {
+      uint32_t bit = seq - recvExpected - 1;
+      if (bit % 8 == 0)
+        sack.push_back(0);
+      if ((seq < recvExpected + capacity && slotFull[seq % capacity]) ||
+          store.has(seq))
+        sack.back() |= 1U << (bit % 8);
+    }
+
+    networkLayer->sendPacket(buildAckPacket(recvExpected, (uint16_t)capacity,
+                                            sack, haveEcho, echoTs));
+    metrics.acksSent.add();
+    framework::trace(framework::TRACE_ACK_SENT, recvExpected, capacity);
+    lastAck = buildAckPacket(recvExpected, (uint16_t)capacity, sack, false, 0);
+    haveEcho = false;
+    pendingAcks = 0;
+    ackNow = false;
+    lastRecvTime = nowMs();
+
+    if (complete) {
+      std::cout << "All " << expectedTotal << " packets received!"
+                << std::endl;
+      store.discard();
+      done = true;
+    }
   }
 
-  std::cout << "Receiver returning " << fileContents.size() << " bytes."
+  std::cout << "Receive buffer: " << recvStats.capacity << " slots, peak "
+            << recvStats.peakOccupied << ", " << recvStats.beyondWindow
+            << " beyond window, " << recvStats.duplicates << " duplicates."
+            << std::endl;
+  if (FEC_MODE || HARQ_MODE)
+    std::cout << "Repairs: " << fecRecovered << " segments decoded."
+              << std::endl;
+  if (PULL_MODE)
+    std::cout << "Pull: " << pull.getStats().requested
+              << " segments requested, " << pull.getStats().rerequested
+              << " again after a timeout; grant limit "
+              << pull.getGrantLimit() << ", srtt "
+              << pull.getSrttUs() / 1000.0 << " ms." << std::endl;
+  if (NACK_MODE)
+    std::cout << "NACK: " << nack.getStats().nacked << " segments reported, "
+              << nack.getStats().renacked
+              << " again after a timeout; advised rate "
+              << nack.getAdvisedPps() << " pkt/s." << std::endl;
+  std::cout << "One-way delay: jitter " << delayStats.jitterUs / 1000.0
+            << " ms, max queueing " << delayStats.maxQueueingUs / 1000.0
+            << " ms over " << delayStats.samples << " samples." << std::endl;
+  std::vector<int32_t> output(fileContents.begin(), fileContents.end());
+  if (DELTA_MODE && done) {
+    std::vector<int32_t> decoded;
+    if (DeltaCodec::decode(output, basis, decoded)) {
+      std::cout << "Delta: " << output.size() << " bytes received for "
+                << decoded.size() << "." << std::endl;
+      output.swap(decoded);
+    } else {
+      std::cout << "Delta: stream does not decode against the basis!"
+                << std::endl;
+    }
+  }
+  std::cout << "Receiver returning " << output.size() << " bytes."
             << std::endl;
-  return fileContents;
+  return output;
 }
 
-void MyProtocol::setFileID(std::string id) { fileID = id; }
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::setFileID(
+    std::string id) {
+  fileID = id;
+}
 
-void MyProtocol::setNetworkLayer(framework::NetworkLayer *nLayer) {
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::setNetworkLayer(
+    framework::NetworkLayer *nLayer) {
   networkLayer = nLayer;
 }
 
-void MyProtocol::TimeoutElapsed(int32_t) {}
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+void BasicProtocol<Window, Ack, Codec, Recovery, Mode>::TimeoutElapsed(
+    int32_t) {}
+
+// Every variant that can be selected by name. Each one is a separate
+// instantiation, so its policy constants fold into its own loops.
+template class BasicProtocol<AdaptiveWindow, SackAck<512>, XorHeader<128, true>,
+                             RackRecovery, StreamMode>;
+template class BasicProtocol<FixedWindow<16>, SackAck<16>,
+                             XorHeader<128, false>, RtoRecovery, StreamMode>;
+template class BasicProtocol<FixedWindow<64>, SackAck<512>,
+                             XorHeader<128, true>, RackRecovery, StreamMode>;
+template class BasicProtocol<AdaptiveWindow, DelayedSackAck<512, 2, 20>,
+                             XorHeader<128, true>, RackRecovery, StreamMode>;
+template class BasicProtocol<AdaptiveWindow, SackAck<512>,
+                             Crc8Header<128, true>, RackRecovery, StreamMode>;
+template class BasicProtocol<AdaptiveWindow, SackAck<512>, XorHeader<128, true>,
+                             RackRecovery, DeltaMode>;
+template class BasicProtocol<AdaptiveWindow, SackAck<512>, XorHeader<128, true>,
+                             RackRecovery, PullMode>;
+template class BasicProtocol<AdaptiveWindow, SackAck<512>, XorHeader<128, true>,
+                             RackRecovery, NackMode>;
+template class BasicProtocol<AdaptiveWindow, SackAck<512>, XorHeader<128, true>,
+                             RackRecovery, FecMode>;
+template class BasicProtocol<AdaptiveWindow, SackAck<512>, XorHeader<128, true>,
+                             RackRecovery, HarqMode>;
+
+namespace {
+
+template <class Protocol> framework::IRDTProtocol *makeProtocol() {
+  return new Protocol();
+}
+
+struct ProtocolVariant {
+  const char *name;
+  framework::IRDTProtocol *(*create)();
+};
+
+const ProtocolVariant VARIANTS[] = {
+    {"default", &makeProtocol<MyProtocol>},
+    {"classic",
+     &makeProtocol<BasicProtocol<FixedWindow<16>, SackAck<16>,
+                                 XorHeader<128, false>, RtoRecovery,
+                                 StreamMode>>},
+    {"fixed64",
+     &makeProtocol<BasicProtocol<FixedWindow<64>, SackAck<512>,
+                                 XorHeader<128, true>, RackRecovery,
+                                 StreamMode>>},
+    {"delayed-ack",
+     &makeProtocol<BasicProtocol<AdaptiveWindow, DelayedSackAck<512, 2, 20>,
+                                 XorHeader<128, true>, RackRecovery,
+                                 StreamMode>>},
+    {"crc8",
+     &makeProtocol<BasicProtocol<AdaptiveWindow, SackAck<512>,
+                                 Crc8Header<128, true>, RackRecovery,
+                                 StreamMode>>},
+    {"delta",
+     &makeProtocol<BasicProtocol<AdaptiveWindow, SackAck<512>,
+                                 XorHeader<128, true>, RackRecovery,
+                                 DeltaMode>>},
+    {"pull",
+     &makeProtocol<BasicProtocol<AdaptiveWindow, SackAck<512>,
+                                 XorHeader<128, true>, RackRecovery,
+                                 PullMode>>},
+    {"nack",
+     &makeProtocol<BasicProtocol<AdaptiveWindow, SackAck<512>,
+                                 XorHeader<128, true>, RackRecovery,
+                                 NackMode>>},
+    {"fec",
+     &makeProtocol<BasicProtocol<AdaptiveWindow, SackAck<512>,
+                                 XorHeader<128, true>, RackRecovery,
+                                 FecMode>>},
+    {"harq",
+     &makeProtocol<BasicProtocol<AdaptiveWindow, SackAck<512>,
+                                 XorHeader<128, true>, RackRecovery,
+                                 HarqMode>>},
+};
+
+} // namespace
+
+framework::IRDTProtocol *createProtocolVariant(const std::string &name) {
+  for (const ProtocolVariant &v : VARIANTS) {
+    if (name == v.name)
+      return v.create();
+  }
+  return nullptr;
+}
+
+std::vector<std::string> protocolVariantNames() {
+  std::vector<std::string> names;
+  for (const ProtocolVariant &v : VARIANTS)
+    names.push_back(v.name);
+  return names;
+}
 
 } /* namespace my_protocol */
@@ -21,19 +21,68 @@
 #define MyProtocol_H_
 
 #include "../framework/IRDTProtocol.h"
+#include "../framework/Metrics.h"
+#include "../framework/Trace.h"
 #include "../framework/NetworkLayer.h"
 #include "../framework/Utils.h"
+#include "AdaptiveWindow.h"
+#include "DeltaCodec.h"
+#include "ErasureCode.h"
+#include "FecPlanner.h"
+#include "NackScheduler.h"
+#include "Policies.h"
+#include "PullScheduler.h"
+#include "ResumeStore.h"
 #include <cstdint>
+#include <deque>
 #include <string>
 #include <vector>
 
 namespace my_protocol {
 
-class MyProtocol : public framework::IRDTProtocol {
+// Occupancy of the receiver's out-of-order buffer, in segments.
+struct ReceiveBufferStats {
+  uint32_t capacity = 0;       // slots allowed by the memory budget
+  uint32_t occupied = 0;       // segments currently held out of order
+  uint32_t peakOccupied = 0;   // high-water mark of occupied
+  uint64_t beyondWindow = 0;   // arrivals dropped past the advertised edge
+  uint64_t duplicates = 0;     // arrivals for segments already held
+};
+
+// One-way delay variation seen by the receiver, from data timestamps. The
+// clocks are not synchronised, so only differences are meaningful.
+struct OneWayDelayStats {
+  uint64_t samples = 0;
+  int64_t jitterUs = 0;        // RFC 3550 smoothed transit variation
+  int64_t maxQueueingUs = 0;   // largest transit above the minimum seen
+};
+
+// Session counters fed by every variant, registered once under
+// "protocol.*" in the shared framework::MetricsRegistry.
+struct ProtocolMetrics {
+  framework::Counter &packetsSent;     // data and repairs, first or again
+  framework::Counter &retransmits;     // segments sent again
+  framework::Counter &packetsReceived; // data that passed its checksum
+  framework::Counter &duplicates;      // data for segments already held
+  framework::Counter &checksumFailed;  // data and ACKs that failed it
+  framework::Counter &acksSent;        // ACKs, keepalives, PULL and NACK
+  framework::Counter &acksReceived;    // ACKs that passed their checksum
+  framework::Counter &sackRecovered;   // segments first acked by a SACK bit
+  framework::Histogram &rttUs;
+  framework::Counter &sendTime;        // microseconds in sender()
+  framework::Counter &receiveTime;     // microseconds in receiver()
+
+  ProtocolMetrics();
+};
+
+// The protocol, parameterised by the policies in Policies.h. Both ends of a
+// transfer must run the same instantiation.
+template <class Window, class Ack, class Codec, class Recovery, class Mode>
+class BasicProtocol : public framework::IRDTProtocol {
 
 public:
-  MyProtocol();
-  ~MyProtocol();
+  BasicProtocol();
+  ~BasicProtocol();
   void sender();
   std::vector<int32_t> receiver();
   void setNetworkLayer(framework::NetworkLayer *);
@@ -41,44 +90,210 @@ public:
   void setStop();
   void TimeoutElapsed(int32_t);
 
+  void setReceiveBufferBytes(size_t bytes);
+  const ReceiveBufferStats &getReceiveBufferStats() const;
+  const OneWayDelayStats &getOneWayDelayStats() const;
+
 private:
   std::string fileID;
   framework::NetworkLayer *networkLayer;
   bool stop = false;
 
+  // Stamp every transmission with a microsecond timestamp that the
+  // receiver echoes back, costing TS_OPTION payload bytes per packet.
+  static const bool USE_TIMESTAMPS = Codec::USE_TIMESTAMPS;
+
   enum : uint32_t {
-    DATA_HEADER = 6,  // type(1) + seq(2) + totalPkts(2) + xor(1)
-    ACK_HEADER = 6,   // type(1) + ackBase(2) + sackMask(2) + xor(1)
-    DATASIZE = 122,   // 128 - 6 header
+    MAX_PACKET = Codec::MAX_PACKET,
+    DATA_HEADER = 6,  // type(1) + seq(2) + totalPkts(2) + check(1)
+    ACK_HEADER = 7,   // type(1) + ackBase(2) + rwnd(2) + sackLen(1) + check(1),
+                      // then the option and sackLen bytes of SACK bitmap
+    TS_OPTION = 4,    // tsVal (data) or tsEcr (ack) after the header, if FLAG_TS
+    DATASIZE = MAX_PACKET - DATA_HEADER - (USE_TIMESTAMPS ? TS_OPTION : 0),
+    HELLO_LEN = 12,   // type(1) + totalPkts(2) + size(4) + crc(4) + check(1)
+    RESUME_HEADER = 5, // type(1) + first(2) + bitmapLen(1) + check(1)
+    RESUME_BITS = (MAX_PACKET - RESUME_HEADER) * 8,
+    SIG_HEADER = 7,   // type(1) + blocks(2) + first(2) + count(1) + check(1)
+    SIG_ENTRY = 12,   // weak(4) + strong(8)
+    SIGS_PER_PACKET = (MAX_PACKET - SIG_HEADER) / SIG_ENTRY,
+    RANGE_HEADER = 9, // type(1) + ackBase(2) + rwnd(2) + rate(2) + ranges(1)
+                      // + check(1), then the ranges; PULL and NACK packets
+    RANGE_ENTRY = 3,  // first(2) + count(1)
+    RANGES_PER_PACKET = (MAX_PACKET - RANGE_HEADER) / RANGE_ENTRY,
+    REPAIR_HEADER = 10, // type(1) + first(2) + stride(1) + count(1) +
+                        // index(1) + mask(2) + tailLen(1) + check(1), then
+                        // DATASIZE coded over the members in mask
+    REPAIR_SOURCES = 16, // block members at most, one mask bit each
     TYPE_DATA = 0,
-    TYPE_ACK = 1
+    TYPE_ACK = 1,
+    TYPE_HELLO = 2,   // sender's file identity, answered by TYPE_RESUME
+    TYPE_RESUME = 3,  // segments the receiver already holds from a prior run
+    TYPE_SIGS = 4,    // basis block signatures, the delta mode answer to HELLO
+    TYPE_PULL = 5,    // pull mode: segments the receiver wants sent next
+    TYPE_NACK = 6,    // NACK mode: missing segments, or none as a heartbeat
+    TYPE_REPAIR = 7,  // FEC mode: coded repair symbol of one block
+    TYPE_MASK = 0x0F,
+    FLAG_TS = 0x80
   };
 
-  static const uint32_t WINDOW = 16;
-  static const uint32_t SACK_BITS = 16;
-  static const int64_t TIMEOUT_MS = 700;
+  static const uint32_t SACK_BITS = Ack::SACK_BITS; // bitmap past ackBase
+  // Assumed until the first ACK advertises the real window; room for a
+  // whole probe train, well inside the default receive buffer.
+  static const uint32_t INITIAL_RWND = 64;
+  static const int64_t TIMEOUT_MS = 700; // RTO until the first RTT sample
+  static const int64_t MIN_RTO_MS = 200;
+  static const int64_t MAX_RTO_MS = 3000;
   static const int64_t ACK_KEEPALIVE_MS = 150;
+  static const size_t RECV_BUFFER_BYTES = 64 * 1024;
+  static const int64_t STORE_FLUSH_MS = 200;
+  static const int DELTA_HELLO_TRIES = 3;
+  static const uint32_t PULL_BURST = 16; // segments sent before any PULL
+  static const uint32_t NACK_INITIAL_PPS = 500; // until the receiver advises
+  static const int64_t NACK_HEARTBEAT_MS = 50;
+  static const bool FEC_FITS = REPAIR_HEADER + DATASIZE <= MAX_PACKET;
+
+  // Known at compile time, so a mode's branches vanish from the loops of
+  // every variant that does not run it.
+  static const bool DELTA_MODE = Mode::DELTA;
+  static const bool PULL_MODE = Mode::PULL;
+  static const bool NACK_MODE = Mode::NACK;
+  static const bool FEC_MODE = Mode::FEC && FEC_FITS;
+  static const bool HARQ_MODE = Mode::HARQ && FEC_FITS;
 
-  std::vector<std::vector<int32_t>> packetBuffer;
+  std::vector<framework::Packet> packetBuffer;
   std::vector<bool> acked;
-  std::vector<int64_t> sentTime;
+  std::vector<int64_t> sentTimeUs; // latest transmission of each segment
   uint32_t sendBase = 0;
   uint32_t nextSeq = 0;
   uint32_t totalPkts = 0;
+  uint32_t rwnd = INITIAL_RWND; // last window advertised by the receiver
+  Window window;
+
+  // Jacobson/Karels estimator fed by timestamp echoes.
+  int64_t srttUs = 0;
+  int64_t rttvarUs = 0;
+  int64_t rtoMs = TIMEOUT_MS;
+  int64_t minRttUs = 0;
+  uint64_t rttSamples = 0;
+
+  // Loss detection state for Recovery::isLost.
+  int64_t rackSentUs = 0; // send time of the latest delivered transmission
+  uint64_t retransmits = 0;
+  uint32_t tracedCwnd = 0; // last window in the trace
+  uint32_t newlyDelivered = 0;
+
+  // Opening exchange: HELLO is repeated every RTO until a RESUME answers.
+  FileIdentity identity;
+  bool helloAnswered = false;
+  int64_t helloSentUs = 0;
+  uint32_t resumedSegments = 0;
 
-  std::vector<int32_t> buildDataPacket(uint32_t seq, uint32_t total,
-                                       const std::vector<int32_t> &fileData,
-                                       uint32_t offset, uint32_t len);
-  std::vector<int32_t> buildAckPacket(uint32_t ackBase, uint16_t sackMask);
+  // Reused across loop iterations so a burst moves in one hand-off each way.
+  std::vector<framework::Packet> inbox;
+  std::vector<framework::Packet> outbox;
+  // Sender scratch, likewise kept so a steady transfer does not allocate.
+  std::vector<uint32_t> harqLost;
+  std::vector<uint8_t> repairSum;
+  std::vector<uint8_t> repairSource;
 
-  uint32_t parseSeq(const std::vector<int32_t> &pkt);
-  uint32_t parseTotalPkts(const std::vector<int32_t> &pkt);
-  bool verifyDataChecksum(const std::vector<int32_t> &pkt);
-  bool verifyAckChecksum(const std::vector<int32_t> &pkt);
+  size_t recvBufferBytes = RECV_BUFFER_BYTES;
+  ReceiveBufferStats recvStats;
+  ProtocolMetrics metrics;
+  OneWayDelayStats delayStats;
+  ResumeStore store;
+
+  std::vector<int32_t> basis;              // receiver: the older output
+  std::vector<BlockSignature> basisSigs;   // sender: as far as received
+  uint32_t sigsReceived = 0;
+  bool sigsAnnounced = false;
+
+  PullScheduler pull;       // receiver
+  uint64_t pullServed = 0;  // sender: segments sent on request
+
+  NackScheduler nack;        // receiver
+  double nackRatePps = NACK_INITIAL_PPS; // sender
+  int64_t nackNextSendUs = 0;
+
+  // One repair symbol still to be sent; the last of a block releases its
+  // members to loss detection.
+  struct RepairJob {
+    uint32_t first;
+    uint32_t stride;
+    uint32_t count;
+    uint32_t index;
+    uint32_t mask;
+    bool last;
+  };
+
+  FecPlanner fecPlanner;
+  FecPlan framePlan;
+  uint32_t frameFirst = 0;
+  uint32_t frameEnd = 0;
+  std::deque<RepairJob> repairQueue;
+  std::vector<int64_t> fecGuardUs; // repairs' send time; -1 = still queued
+  std::vector<bool> holeSeen;      // first transmission shown lost by SACK
+  uint64_t repairsSent = 0;
+  uint64_t fecRecovered = 0;       // receiver
+
+  std::vector<uint32_t> harqNextIndex; // per block, repairs used so far
+  std::vector<bool> harqOutstanding;   // covered by a round, not yet acked
+
+  framework::Packet buildDataPacket(uint32_t seq, uint32_t total,
+                                    const std::vector<int32_t> &fileData,
+                                    uint32_t offset, uint32_t len);
+  framework::Packet buildAckPacket(uint32_t ackBase, uint16_t advertised,
+                                   const std::vector<uint8_t> &sack,
+                                   bool echo, uint32_t tsEcr);
+  void stampTimestamp(framework::Packet &pkt, uint32_t tsVal);
+  framework::Packet buildHelloPacket();
+  void buildResumePackets(std::vector<framework::Packet> &out);
+  void buildSigPackets(std::vector<framework::Packet> &out);
+  void buildRangePackets(uint32_t type, uint32_t ackBase, uint16_t advertised,
+                         uint16_t ratePps, const std::vector<uint32_t> &seqs,
+                         std::vector<framework::Packet> &out);
+
+  uint32_t parseSeq(const framework::Packet &pkt);
+  uint32_t parseTotalPkts(const framework::Packet &pkt);
+  uint32_t parseTimestamp(const framework::Packet &pkt, uint32_t header);
+  bool hasTimestamp(const framework::Packet &pkt, uint32_t header);
+  bool verifyDataChecksum(const framework::Packet &pkt);
+  bool verifyAckChecksum(const framework::Packet &pkt);
+  void updateRtt(int64_t sampleUs);
+  bool markAcked(uint32_t seq, int64_t nowU);
+  void handleAck(const framework::Packet &pkt, int64_t nowU);
+  void handleResume(const framework::Packet &pkt);
+  bool parseHello(const framework::Packet &pkt, FileIdentity &out);
+  void handleSigs(const framework::Packet &pkt);
+  bool verifyRangePacket(const framework::Packet &pkt);
+  void handlePull(const framework::Packet &pkt, int64_t nowU);
+  void handleNack(const framework::Packet &pkt, int64_t nowU);
+  bool nackPaceAllows(int64_t nowU);
+  void startFrame(uint32_t first);
+  void queueRepairs(uint32_t seq);
+  void sendHarqRepairs(const std::vector<uint32_t> &lost, int64_t nowU);
+  framework::Packet buildRepairPacket(const RepairJob &job);
+  std::vector<int32_t> negotiateDelta(const std::vector<int32_t> &target);
+  void setIdentity(const std::vector<int32_t> &contents);
+  void flushOutbox();
+  void countRetransmit(uint32_t seq);
 
   int64_t nowMs();
+  int64_t nowUs();
 };
 
+// The tuned default: probe-seeded adaptive window, a SACK bitmap on every
+// burst, XOR-checked 128-byte packets with timestamps, and RACK.
+typedef BasicProtocol<AdaptiveWindow, SackAck<512>, XorHeader<128, true>,
+                      RackRecovery, StreamMode>
+    MyProtocol;
+
+// Instantiates the protocol variant registered under name, or returns
+// nullptr if there is none.
+framework::IRDTProtocol *createProtocolVariant(const std::string &name);
+
+// Names accepted by createProtocolVariant, the default first.
+std::vector<std::string> protocolVariantNames();
+
 } /* namespace my_protocol */
 
 #endif /* MyProtocol_H_ */
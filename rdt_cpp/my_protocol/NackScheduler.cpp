@@ -0,0 +1,99 @@
+/**
+ * NackScheduler.cpp
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#include "NackScheduler.h"
+
+namespace my_protocol {
+
+NackScheduler::NackScheduler()
+    : latestTs(0), haveTs(false), started(false), srttUs(0), rttvarUs(0),
+      reorderUs(MIN_REORDER_US), intervalArrivals(0), intervalStartUs(0),
+      intervalMinQueueUs(0), lastQueueUs(0), slowStart(true), advisedPps(0) {}
+
+void NackScheduler::start(uint32_t totalPkts) {
+  missingSinceUs.assign(totalPkts, 0);
+  nackedUs.assign(totalPkts, 0);
+  nackCount.assign(totalPkts, 0);
+  nackedTs.assign(totalPkts, 0);
+  started = true;
+}
+
+bool NackScheduler::isStarted() const { return started; }
+
+// The sender transmits in timestamp order, so a repair left after
+// everything seen before its NACK, and a segment that left before one
+// already seen was reordered; for that, like RACK, the reorder window grows
+// to cover how long it was missing. A repair
+// of a segment reported exactly once gives an unambiguous NACK-to-repair
+// RTT. Over each interval, a standing queue above the target (CoDel's
+// minimum sojourn, so jitter alone does not count) asks the sender to slow
+// below the arrival rate by enough to drain it within the next interval;
+// otherwise it may probe above it, doubling until the first queue shows.
+void NackScheduler::onArrival(uint32_t seq, uint32_t tsVal,
+                              int64_t queueingUs, int64_t nowUs) {
+  if (seq < nackedUs.size() && missingSinceUs[seq] != 0) {
+    bool repair =
+        nackCount[seq] > 0 && (int32_t)(tsVal - nackedTs[seq]) > 0;
+    if (!repair && haveTs && (int32_t)(tsVal - latestTs) < 0) {
+      reorderUs = std::max(reorderUs, (nowUs - missingSinceUs[seq]) * 5 / 4);
+    } else if (repair && nackCount[seq] == 1) {
+      int64_t sample = nowUs - nackedUs[seq];
+      if (srttUs == 0) {
+        srttUs = sample;
+        rttvarUs = sample / 2;
+      } else {
+        int64_t err = sample - srttUs;
+        srttUs += err / 8;
+        rttvarUs += ((err < 0 ? -err : err) - rttvarUs) / 4;
+      }
+    }
+    missingSinceUs[seq] = 0;
+  }
+  if (!haveTs || (int32_t)(tsVal - latestTs) > 0)
+    latestTs = tsVal;
+  haveTs = true;
+
+  lastQueueUs = queueingUs;
+  if (intervalArrivals == 0 || queueingUs < intervalMinQueueUs)
+    intervalMinQueueUs = queueingUs;
+  if (intervalStartUs == 0)
+    intervalStartUs = nowUs;
+  intervalArrivals++;
+  int64_t span = nowUs - intervalStartUs;
+  if (span < RATE_INTERVAL_US)
+    return;
+
+  double rate = intervalArrivals * 1e6 / span;
+  if (intervalMinQueueUs > TARGET_QUEUE_US) {
+    slowStart = false;
+    advisedPps = rate * RATE_INTERVAL_US /
+                 (RATE_INTERVAL_US + intervalMinQueueUs);
+  } else {
+    // A slow interval without a queue means the sender held back, for
+    // instance at the window edge, not that the path got slower.
+    advisedPps =
+        std::max(advisedPps, rate * (slowStart ? STARTUP_GAIN : PROBE_GAIN));
+  }
+  intervalArrivals = 0;
+  intervalStartUs = nowUs;
+}
+
+uint32_t NackScheduler::getAdvisedPps() const {
+  return (uint32_t)std::min(advisedPps, 65535.0);
+}
+
+// A repair waits behind whatever queue has built up since the samples.
+int64_t NackScheduler::getRtoUs() const {
+  if (srttUs == 0)
+    return INITIAL_RTO_US;
+  int64_t minRto = MIN_RTO_US;
+  return std::max(srttUs + 4 * rttvarUs, minRto) + lastQueueUs;
+}
+
+const NackScheduler::Stats &NackScheduler::getStats() const { return stats; }
+
+} /* namespace my_protocol */
@@ -0,0 +1,113 @@
+/**
+ * NackScheduler.h
+ *
+ * Receiver side of NACK mode: notices holes once the reordering seen so far
+ * can no longer explain them, repeats a NACK whose repair did not arrive in
+ * time, and advises the sender a pacing rate from the arrival rate and the
+ * standing queue seen in one-way delay.
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#ifndef NackScheduler_H_
+#define NackScheduler_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace my_protocol {
+
+class NackScheduler {
+
+public:
+  struct Stats {
+    uint64_t nacked = 0;   // segments reported missing, repeats included
+    uint64_t renacked = 0; // segments reported again after a timeout
+  };
+
+  NackScheduler();
+
+  void start(uint32_t totalPkts);
+  bool isStarted() const;
+
+  // tsVal is the segment's departure timestamp in the sender's clock, and
+  // queueingUs its one-way transit above the lowest seen.
+  void onArrival(uint32_t seq, uint32_t tsVal, int64_t queueingUs,
+                 int64_t nowUs);
+
+  // Appends to out the segments in [from, to) to report now: those not
+  // held that have been missing for the reorder window, and were not
+  // reported within the last RTO.
+  template <class Held>
+  void collect(uint32_t from, uint32_t to, const Held &held, int64_t nowUs,
+               std::vector<uint32_t> &out);
+
+  uint32_t getAdvisedPps() const; // 0 until the first interval is measured
+  int64_t getRtoUs() const;
+  const Stats &getStats() const;
+
+private:
+  static const int64_t INITIAL_RTO_US = 300000;
+  static const int64_t MIN_RTO_US = 20000;
+  static const int64_t MIN_REORDER_US = 2000;
+  static const int64_t RATE_INTERVAL_US = 50000;
+  static const int64_t TARGET_QUEUE_US = 5000;
+  static constexpr double STARTUP_GAIN = 2.0;
+  static constexpr double PROBE_GAIN = 1.25;
+
+  std::vector<int64_t> missingSinceUs; // 0 = not seen missing
+  std::vector<int64_t> nackedUs;       // latest report, 0 = never
+  std::vector<uint8_t> nackCount;
+  std::vector<uint32_t> nackedTs;      // latestTs at the first report
+  uint32_t latestTs;                   // newest departure seen
+  bool haveTs;
+  bool started;
+
+  int64_t srttUs;
+  int64_t rttvarUs;
+  int64_t reorderUs; // widened whenever a hole fills without a NACK
+
+  // Arrivals and the smallest queueing delay over the current interval.
+  uint32_t intervalArrivals;
+  int64_t intervalStartUs;
+  int64_t intervalMinQueueUs;
+  int64_t lastQueueUs;
+  bool slowStart;
+  double advisedPps;
+
+  Stats stats;
+};
+
+template <class Held>
+void NackScheduler::collect(uint32_t from, uint32_t to, const Held &held,
+                            int64_t nowUs, std::vector<uint32_t> &out) {
+  if (to > missingSinceUs.size())
+    to = (uint32_t)missingSinceUs.size();
+  int64_t rto = getRtoUs();
+
+  for (uint32_t seq = from; seq < to; seq++) {
+    if (held(seq))
+      continue;
+    if (missingSinceUs[seq] == 0)
+      missingSinceUs[seq] = nowUs;
+    if (nowUs - missingSinceUs[seq] < reorderUs)
+      continue;
+    if (nackedUs[seq] != 0 && nowUs - nackedUs[seq] <= rto)
+      continue;
+    if (nackedUs[seq] != 0)
+      stats.renacked++;
+    stats.nacked++;
+    if (nackedUs[seq] == 0)
+      nackedTs[seq] = latestTs;
+    nackedUs[seq] = nowUs;
+    if (nackCount[seq] < 0xFF)
+      nackCount[seq]++;
+    out.push_back(seq);
+  }
+}
+
+} /* namespace my_protocol */
+
+#endif /* NackScheduler_H_ */
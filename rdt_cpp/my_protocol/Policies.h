@@ -0,0 +1,175 @@
+/**
+ * Policies.h
+ *
+ * Compile-time policies that BasicProtocol is parameterised by. Every
+ * constant here is known at compile time, so each protocol variant gets
+ * its own constant-folded hot loops.
+ *
+ *   Window   - how many segments may be in flight and when the next may
+ *              leave: start, onRttSample, onDelivered, onAckBurst, onLoss,
+ *              paceAllows, getCwnd, getLossStats (see AdaptiveWindow).
+ *   Ack      - SACK_BITS bitmap width, ACK_EVERY arrivals per ACK, and
+ *              ACK_DELAY_MS before a pending ACK goes out anyway.
+ *   Codec    - MAX_PACKET size, USE_TIMESTAMPS, and the header check().
+ *   Recovery - isLost(), deciding when an unacknowledged segment is lost.
+ *   Mode     - which transfer the loops run: DELTA, PULL, NACK, FEC and
+ *              HARQ, each off for the plain acknowledged stream.
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#ifndef Policies_H_
+#define Policies_H_
+
+#include "../framework/Packet.h"
+#include "LossClassifier.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace my_protocol {
+
+// Window policy with a constant cwnd, no pacing and no reaction to loss.
+template <uint32_t Window> class FixedWindow {
+
+public:
+  void start(uint32_t, int64_t) {}
+  void onRttSample(int64_t) {}
+  void onDelivered(uint32_t) {}
+  void onAckBurst(uint32_t, int64_t, int64_t, int64_t) {}
+  void onLoss(uint32_t, uint32_t) {}
+  bool paceAllows(int64_t) { return true; }
+
+  uint32_t getCwnd() const { return Window; }
+  const LossClassifier::Stats &getLossStats() const { return stats; }
+
+private:
+  LossClassifier::Stats stats;
+};
+
+// Acknowledge every burst of arrivals straight away.
+template <uint32_t SackBits> struct SackAck {
+  static const uint32_t SACK_BITS = SackBits;
+  static const uint32_t ACK_EVERY = 1;
+  static const int64_t ACK_DELAY_MS = 0;
+};
+
+// Acknowledge every Every-th in-order arrival, or after DelayMs, but at
+// once whenever a segment arrives out of order or fills a hole.
+template <uint32_t SackBits, uint32_t Every, int64_t DelayMs>
+struct DelayedSackAck {
+  static const uint32_t SACK_BITS = SackBits;
+  static const uint32_t ACK_EVERY = Every;
+  static const int64_t ACK_DELAY_MS = DelayMs;
+};
+
+// Header protected by an XOR of its bytes.
+template <uint32_t PacketSize, bool Timestamps> struct XorHeader {
+  static const uint32_t MAX_PACKET = PacketSize;
+  static const bool USE_TIMESTAMPS = Timestamps;
+
+  // Covers the bytes between the type byte and the check byte at
+  // header - 1, plus [header, end).
+  static uint8_t check(const framework::Packet &pkt, uint32_t header,
+                       size_t end) {
+    uint8_t x = 0;
+    for (uint32_t i = 1; i < header - 1; i++)
+      x ^= pkt[i];
+    for (size_t i = header; i < end && i < pkt.size(); i++)
+      x ^= pkt[i];
+    return x;
+  }
+};
+
+// Header protected by a CRC-8 (polynomial 0x07), which unlike XOR also
+// catches swapped and doubly flipped bytes.
+template <uint32_t PacketSize, bool Timestamps> struct Crc8Header {
+  static const uint32_t MAX_PACKET = PacketSize;
+  static const bool USE_TIMESTAMPS = Timestamps;
+
+  static uint8_t check(const framework::Packet &pkt, uint32_t header,
+                       size_t end) {
+    uint8_t crc = 0;
+    for (uint32_t i = 1; i < header - 1; i++)
+      crc = step(crc, pkt[i]);
+    for (size_t i = header; i < end && i < pkt.size(); i++)
+      crc = step(crc, pkt[i]);
+    return crc;
+  }
+
+private:
+  static uint8_t step(uint8_t crc, uint8_t byte) {
+    crc ^= byte;
+    for (int b = 0; b < 8; b++)
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    return crc;
+  }
+};
+
+// RACK: lost once a segment sent more than a reordering window later has
+// been delivered, with the RTO as a fallback.
+struct RackRecovery {
+  static bool isLost(int64_t sentUs, int64_t rackSentUs, int64_t reoWndUs,
+                     int64_t nowUs, int64_t rtoUs) {
+    return sentUs + reoWndUs < rackSentUs || nowUs - sentUs > rtoUs;
+  }
+};
+
+// Go-back-to-timeouts: a segment is only lost when its RTO expires.
+struct RtoRecovery {
+  static bool isLost(int64_t sentUs, int64_t, int64_t, int64_t nowUs,
+                     int64_t rtoUs) {
+    return nowUs - sentUs > rtoUs;
+  }
+};
+
+// The acknowledged stream that every mode below builds on.
+struct StreamMode {
+  static const bool DELTA = false;
+  static const bool PULL = false;
+  static const bool NACK = false;
+  static const bool FEC = false;
+  static const bool HARQ = false;
+};
+
+// Sends the file as an rsync-style delta against the receiver's newest
+// earlier output of it. Delta transfers are not resumable, since the
+// stream depends on the basis.
+struct DeltaMode : StreamMode {
+  static const bool DELTA = true;
+};
+
+// Receiver-driven transfer: after an unscheduled burst the sender only
+// sends the segments the receiver names in PULL requests, and the receiver
+// paces those to its arrival rate and buffer.
+struct PullMode : StreamMode {
+  static const bool PULL = true;
+};
+
+// For clean channels: the sender streams at the rate the receiver advises,
+// and the receiver only reports missing ranges plus a periodic progress
+// heartbeat instead of acknowledging every burst.
+struct NackMode : StreamMode {
+  static const bool NACK = true;
+};
+
+// Protects every frame of segments with erasure-coded repairs, sized by
+// FecPlanner from the losses the SACKs have shown so far, so most holes
+// fill without waiting for a retransmission. Only takes effect if a repair
+// fits in a packet next to a full segment.
+struct FecMode : StreamMode {
+  static const bool FEC = true;
+};
+
+// Hybrid ARQ: segments lost from a block that was sent in full are not
+// resent as copies; each round sends as many new coded repairs of the block
+// as it has holes, and the receiver decodes from every repair it has
+// collected for that block so far. Needs the same room as FEC.
+struct HarqMode : StreamMode {
+  static const bool HARQ = true;
+};
+
+} /* namespace my_protocol */
+
+#endif /* Policies_H_ */
@@ -6,6 +6,7 @@
  * Copyright: University of Twente, 2015-2025
  */
 
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <time.h>
@@ -18,7 +19,9 @@
 
 #include "../framework/DRDTChallengeClient.h"
 #include "../framework/IRDTProtocol.h"
+#include "../framework/Metrics.h"
 #include "../framework/NetworkLayer.h"
+#include "../framework/Trace.h"
 #include "MyProtocol.h"
 
 using namespace my_protocol;
@@ -30,8 +33,29 @@ std::string groupToken = "1b197b7f-bbc6-4076-8ce9-e1ebb44107a4";
 // Sizes in bytes are: 248, 2085, 6267, 21067, 53228, 141270
 std::string file = "6";
 
-// Change to your protocol implementation
-framework::IRDTProtocol *createProtocol() { return new MyProtocol(); }
+// Change to your protocol implementation. RDT_VARIANT picks one of the
+// variants registered in MyProtocol.cpp; unknown names fall back to the
+// default.
+framework::IRDTProtocol *createProtocol() {
+  const char *name = getenv("RDT_VARIANT");
+  framework::IRDTProtocol *protocol =
+      createProtocolVariant(name != nullptr ? name : "default");
+  if (protocol == nullptr) {
+    std::cout << "Unknown RDT_VARIANT " << name << ", using default."
+              << std::endl;
+    protocol = createProtocolVariant("default");
+    name = nullptr;
+  }
+  framework::MetricsRegistry::shared().setLabel(
+      "variant", name != nullptr ? name : "default");
+  return protocol;
+}
+
+// Packet events are traced unless RDT_TRACE=0.
+bool traceEnabled() {
+  const char *trace = getenv("RDT_TRACE");
+  return trace == nullptr || std::string(trace) != "0";
+}
 
 // Challenge server address
 std::string serverAddress = "challenges.dacs.utwente.nl";
@@ -49,6 +73,7 @@ std::string file_timestamp; // only used to write the timestamp for the output
                             // file to make finding it easy.
 
 int main(int argc, char *argv[]) {
+  framework::TraceRing::shared().setEnabled(traceEnabled());
 
   if (argc == 2) { // possible file number entered
     std::string temp_file = argv[1];
@@ -131,6 +156,9 @@ int main(int argc, char *argv[]) {
     framework::IRDTProtocol *protocolImpl = createProtocol();
     protocolImpl->setNetworkLayer(networkLayer);
     protocolImpl->setFileID(drdtclient.getFileID());
+    framework::MetricsRegistry::shared().setLabel("file", file);
+    framework::MetricsRegistry::shared().setLabel(
+        "role", startCommand ? "sender" : "receiver");
     if (startCommand) {
       std::cout
           << "[FRAMEWORK] Running protocol implementation as sender for file "
@@ -145,9 +173,13 @@ int main(int argc, char *argv[]) {
       std::cout << "[FRAMEWORK] Running protocol implementation as receiver..."
                 << std::endl;
       std::vector<int32_t> fileContents = protocolImpl->receiver();
-      framework::setFileContents(fileContents, file, file_timestamp);
-      drdtclient.sendChecksum("OUT", "rdtcOutput" + file + "." +
-                                         file_timestamp.c_str() + ".png");
+      // The checksum comes from memory, so the verdict does not wait for
+      // the output file, which is written meanwhile.
+      std::thread writeThread([&fileContents, &file_timestamp] {
+        framework::setFileContents(fileContents, file, file_timestamp);
+      });
+      drdtclient.sendChecksum("OUT", fileContents);
+      writeThread.join();
     }
 
     // terminate
@@ -155,6 +187,20 @@ int main(int argc, char *argv[]) {
     std::cout << "[FRAMEWORK] Shutting down client... " << std::endl;
     delete protocolImpl;
     drdtclient.stop();
+
+    // Session summary, with the score if the server sent one.
+    std::string metricsFile = "rdtcMetrics" + file + "." + file_timestamp +
+                              "." + (startCommand ? "sender" : "receiver") +
+                              ".json";
+    if (framework::MetricsRegistry::shared().writeJson(metricsFile))
+      std::cout << "[FRAMEWORK] Metrics written to " << metricsFile
+                << std::endl;
+    // Packet timeline; make traceqlog converts it for plotting.
+    std::string traceFile = "rdtcTrace" + file + "." + file_timestamp + "." +
+                            (startCommand ? "sender" : "receiver") + ".bin";
+    if (traceEnabled() &&
+        framework::TraceRing::shared().writeFile(traceFile))
+      std::cout << "[FRAMEWORK] Trace written to " << traceFile << std::endl;
     std::cout << "[FRAMEWORK] Done." << std::endl;
   }
 
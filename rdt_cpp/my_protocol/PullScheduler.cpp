@@ -0,0 +1,120 @@
+/**
+ * PullScheduler.cpp
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#include "PullScheduler.h"
+
+#include <algorithm>
+
+namespace my_protocol {
+
+PullScheduler::PullScheduler()
+    : started(false), minGrant(1), maxGrant(1), grant(1), slowStart(true),
+      delivered(0), roundDelivered(0), roundExpired(0), roundStartUs(0),
+      rates(), round(0), lossFraction(0), fullPipeRate(0),
+      roundsWithoutGrowth(0), srttUs(0), rttvarUs(0), minRttUs(0) {}
+
+// The unscheduled segments count as requested, but never as a first
+// request, so their arrivals give no RTT sample.
+void PullScheduler::start(uint32_t totalPkts, uint32_t unscheduled,
+                          uint32_t maxOutstanding, int64_t nowUs) {
+  requestedUs.assign(totalPkts, 0);
+  requestCount.assign(totalPkts, 0);
+  for (uint32_t seq = 0; seq < unscheduled && seq < totalPkts; seq++)
+    requestedUs[seq] = nowUs;
+  maxGrant = std::max<uint32_t>(maxOutstanding, 1);
+  minGrant = std::min(std::max<uint32_t>(unscheduled, 1), maxGrant);
+  grant = minGrant;
+  roundStartUs = nowUs;
+  started = true;
+}
+
+bool PullScheduler::isStarted() const { return started; }
+
+// Every arrival counts towards the rate; a segment requested exactly once
+// also gives an unambiguous request-to-arrival RTT.
+void PullScheduler::onArrival(uint32_t seq, int64_t nowUs) {
+  if (!started)
+    return;
+  delivered++;
+  if (slowStart)
+    grant = std::min(grant + 1.0, rateGrant(STARTUP_GAIN));
+  if (srttUs != 0 && nowUs - roundStartUs >= srttUs)
+    onRoundEnd(nowUs);
+  grant = std::max(std::min(grant, (double)maxGrant), (double)minGrant);
+
+  if (seq >= requestedUs.size() || requestCount[seq] != 1)
+    return;
+  int64_t sample = nowUs - requestedUs[seq];
+  if (srttUs == 0) {
+    srttUs = sample;
+    rttvarUs = sample / 2;
+  } else {
+    int64_t err = sample - srttUs;
+    srttUs += err / 8;
+    rttvarUs += ((err < 0 ? -err : err) - rttvarUs) / 4;
+  }
+  if (minRttUs == 0 || sample < minRttUs)
+    minRttUs = sample;
+}
+
+// Sized from the rate grants are freed at rather than from queueing
+// delay, which the path's jitter alone pushes past any tight target. By
+// Little's law the grant the path can use is that rate times how long a
+// grant is held: a round trip for a segment that arrives, a timeout for
+// one that is lost. Slow start grows the grant by one per arrival, to at
+// most twice that, until the rate stops growing; after it the grant keeps
+// some headroom over it so the rate can still rise.
+void PullScheduler::onRoundEnd(int64_t nowUs) {
+  uint64_t arrived = delivered - roundDelivered;
+  uint64_t expired = stats.rerequested - roundExpired;
+  rates[round++ % RATE_ROUNDS] =
+      (double)(arrived + expired) / (nowUs - roundStartUs);
+  lossFraction += ((double)expired / (arrived + expired) - lossFraction) / 4;
+  roundDelivered = delivered;
+  roundExpired = stats.rerequested;
+  roundStartUs = nowUs;
+
+  double best = maxRate();
+  if (best >= fullPipeRate * FULL_PIPE_GROWTH) {
+    fullPipeRate = best;
+    roundsWithoutGrowth = 0;
+  } else if (++roundsWithoutGrowth >= FULL_PIPE_ROUNDS) {
+    slowStart = false;
+  }
+  if (!slowStart)
+    grant = rateGrant(GRANT_GAIN);
+}
+
+double PullScheduler::maxRate() const {
+  return *std::max_element(rates, rates + RATE_ROUNDS);
+}
+
+double PullScheduler::holdUs() const {
+  return (1 - lossFraction) * minRttUs + lossFraction * rtoUs();
+}
+
+// Before the first round trip there is no rate to go by.
+double PullScheduler::rateGrant(double gain) const {
+  if (round == 0)
+    return maxGrant;
+  return maxRate() * holdUs() * gain;
+}
+
+int64_t PullScheduler::rtoUs() const {
+  if (srttUs == 0)
+    return INITIAL_RTO_US;
+  int64_t minRto = MIN_RTO_US;
+  return std::max(srttUs + 4 * rttvarUs, minRto);
+}
+
+uint32_t PullScheduler::getGrantLimit() const { return (uint32_t)grant; }
+
+int64_t PullScheduler::getSrttUs() const { return srttUs; }
+
+const PullScheduler::Stats &PullScheduler::getStats() const { return stats; }
+
+} /* namespace my_protocol */
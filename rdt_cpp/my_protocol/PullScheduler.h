@@ -0,0 +1,135 @@
+/**
+ * PullScheduler.h
+ *
+ * Receiver side of pull mode: decides which segments to request next, how
+ * many may be outstanding, and when a request has been lost, so the sender
+ * only ever sends what the receiver asked for.
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#ifndef PullScheduler_H_
+#define PullScheduler_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace my_protocol {
+
+class PullScheduler {
+
+public:
+  struct Stats {
+    uint64_t requested = 0;   // segments asked for, repeats included
+    uint64_t rerequested = 0; // segments asked for again after a timeout
+  };
+
+  PullScheduler();
+
+  // The sender's first `unscheduled` segments are on their way already;
+  // no more than maxOutstanding may ever be.
+  void start(uint32_t totalPkts, uint32_t unscheduled,
+             uint32_t maxOutstanding, int64_t nowUs);
+  bool isStarted() const;
+
+  void onArrival(uint32_t seq, int64_t nowUs);
+
+  // Appends to out the segments in [from, to) to request now: those not
+  // held and not already outstanding, up to the grant limit. Requests wait
+  // until a batch's worth of grants is free, so one PULL names several.
+  template <class Held>
+  void schedule(uint32_t from, uint32_t to, const Held &held, int64_t nowUs,
+                std::vector<uint32_t> &out);
+
+  uint32_t getGrantLimit() const;
+  int64_t getSrttUs() const;
+  const Stats &getStats() const;
+
+private:
+  static const int64_t INITIAL_RTO_US = 300000;
+  static const int64_t MIN_RTO_US = 20000;
+  static const uint32_t BATCH_DIVISOR = 8;
+  static const uint32_t RATE_ROUNDS = 8;      // round trips the rate is kept
+  static const uint32_t FULL_PIPE_ROUNDS = 3; // without growth to end slow start
+  static constexpr double FULL_PIPE_GROWTH = 1.25;
+  static constexpr double STARTUP_GAIN = 2.0; // times the grant the path can
+  static constexpr double GRANT_GAIN = 1.5;   // use, in and after slow start
+
+  std::vector<int64_t> requestedUs; // 0 = never requested
+  std::vector<uint8_t> requestCount;
+  std::vector<uint32_t> candidates; // schedule's, kept to reuse its storage
+  bool started;
+  uint32_t minGrant;
+  uint32_t maxGrant;
+  double grant;
+  bool slowStart;
+
+  // Grants freed per microsecond, by an arrival or by a request timing
+  // out, measured each round trip; the grant follows its recent maximum.
+  uint64_t delivered;
+  uint64_t roundDelivered;
+  uint64_t roundExpired;
+  int64_t roundStartUs;
+  double rates[RATE_ROUNDS];
+  uint32_t round;
+  double lossFraction; // of requests, smoothed over round trips
+  double fullPipeRate;
+  uint32_t roundsWithoutGrowth;
+
+  int64_t srttUs;
+  int64_t rttvarUs;
+  int64_t minRttUs;
+
+  Stats stats;
+
+  int64_t rtoUs() const;
+  void onRoundEnd(int64_t nowUs);
+  double maxRate() const;
+  double holdUs() const;
+  double rateGrant(double gain) const;
+};
+
+template <class Held>
+void PullScheduler::schedule(uint32_t from, uint32_t to, const Held &held,
+                             int64_t nowUs, std::vector<uint32_t> &out) {
+  if (to > requestedUs.size())
+    to = (uint32_t)requestedUs.size();
+  int64_t rto = rtoUs();
+
+  uint32_t limit = getGrantLimit();
+  uint32_t outstanding = 0;
+  candidates.clear();
+  for (uint32_t seq = from; seq < to; seq++) {
+    if (held(seq))
+      continue;
+    if (requestedUs[seq] != 0 && nowUs - requestedUs[seq] <= rto)
+      outstanding++;
+    else
+      candidates.push_back(seq);
+  }
+
+  if (outstanding >= limit)
+    return;
+  size_t batch = std::max<uint32_t>(limit / BATCH_DIVISOR, 1);
+  if (limit - outstanding < std::min(batch, candidates.size()))
+    return;
+
+  for (uint32_t seq : candidates) {
+    if (outstanding >= limit)
+      break;
+    if (requestedUs[seq] != 0)
+      stats.rerequested++;
+    stats.requested++;
+    requestedUs[seq] = nowUs;
+    if (requestCount[seq] < 0xFF)
+      requestCount[seq]++;
+    outstanding++;
+    out.push_back(seq);
+  }
+}
+
+} /* namespace my_protocol */
+
+#endif /* PullScheduler_H_ */
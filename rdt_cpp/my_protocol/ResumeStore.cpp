@@ -0,0 +1,211 @@
+/**
+ * ResumeStore.cpp
+ *
+ * File layout, all integers little-endian 32-bit: magic, version, then the
+ * FileIdentity fields in declaration order, then the presence bitmap and
+ * totalPkts * segmentSize bytes of segment data. Segments are written in
+ * place, so the data area may end early or hold holes where bits are 0.
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#include "ResumeStore.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+namespace my_protocol {
+
+namespace {
+
+void putWord(std::vector<uint8_t> &out, uint32_t v) {
+  for (int i = 0; i < 4; i++)
+    out.push_back((v >> (8 * i)) & 0xFF);
+}
+
+uint32_t getWord(const std::vector<uint8_t> &in, size_t at) {
+  uint32_t v = 0;
+  for (int i = 3; i >= 0; i--)
+    v = (v << 8) | in[at + i];
+  return v;
+}
+
+} // namespace
+
+ResumeStore::ResumeStore()
+    : opened(false), persisting(false), count(0), bitmapFirst(0),
+      bitmapEnd(0) {}
+
+uint32_t ResumeStore::open(const std::string &path,
+                           const FileIdentity &identity) {
+  this->path = path;
+  this->identity = identity;
+  opened = true;
+  persisting = true;
+  count = 0;
+  present.assign((identity.totalPkts + 7) / 8, 0);
+  pendingSeqs.clear();
+  pendingData.clear();
+  bitmapFirst = present.size();
+  bitmapEnd = 0;
+  if (file.is_open())
+    file.close();
+  if (!load()) {
+    if (file.is_open())
+      file.close();
+    file.clear();
+    std::fill(present.begin(), present.end(), 0);
+    count = 0;
+  }
+  return count;
+}
+
+bool ResumeStore::isOpen() const { return opened; }
+
+bool ResumeStore::has(uint32_t seq) const {
+  return opened && seq < identity.totalPkts &&
+         (present[seq / 8] >> (seq % 8)) & 1;
+}
+
+uint32_t ResumeStore::getCount() const { return count; }
+
+uint32_t ResumeStore::getHighest() const {
+  for (uint32_t seq = identity.totalPkts; seq-- > 0;) {
+    if (has(seq))
+      return seq;
+  }
+  return 0;
+}
+
+uint32_t ResumeStore::getLength(uint32_t seq) const {
+  uint32_t offset = seq * identity.segmentSize;
+  return std::min(identity.segmentSize, identity.size - offset);
+}
+
+void ResumeStore::put(uint32_t seq, const uint8_t *first, const uint8_t *last) {
+  if (!opened || !persisting || seq >= identity.totalPkts || has(seq))
+    return;
+  size_t at = pendingData.size();
+  pendingData.resize(at + identity.segmentSize, 0);
+  std::copy(first, last, pendingData.begin() + at);
+  pendingSeqs.push_back(seq);
+  present[seq / 8] |= 1U << (seq % 8);
+  bitmapFirst = std::min<size_t>(bitmapFirst, seq / 8);
+  bitmapEnd = std::max<size_t>(bitmapEnd, seq / 8 + 1);
+  count++;
+}
+
+void ResumeStore::appendTo(uint32_t seq, std::vector<uint8_t> &out) {
+  uint32_t length = getLength(seq);
+  for (size_t i = pendingSeqs.size(); i-- > 0;) {
+    if (pendingSeqs[i] == seq) {
+      const uint8_t *in = &pendingData[i * identity.segmentSize];
+      out.insert(out.end(), in, in + length);
+      return;
+    }
+  }
+  size_t at = out.size();
+  out.resize(at + length, 0);
+  file.clear(); // a failed write must not stop flushed segments being read
+  file.seekg(offsetOf(seq));
+  if (!file.read((char *)out.data() + at, length))
+    file.clear();
+}
+
+// Segment data goes out before the bitmap bytes that claim it, so an abort
+// in the middle of a flush at worst loses the segments of that flush.
+void ResumeStore::flush() {
+  if (!opened || !persisting || pendingSeqs.empty())
+    return;
+  if (file.is_open() || create()) {
+    for (size_t i = 0; i < pendingSeqs.size(); i++) {
+      file.seekp(offsetOf(pendingSeqs[i]));
+      file.write((const char *)&pendingData[i * identity.segmentSize],
+                 getLength(pendingSeqs[i]));
+    }
+    file.flush();
+    file.seekp(HEADER_BYTES + bitmapFirst);
+    file.write((const char *)&present[bitmapFirst], bitmapEnd - bitmapFirst);
+    file.flush();
+  }
+  if (!file.good()) {
+    std::cout << "Cannot write " << path << ", not keeping segments."
+              << std::endl;
+    persisting = false;
+    // Segments flushed before stay held; the dropped ones never were.
+    for (uint32_t seq : pendingSeqs)
+      present[seq / 8] &= ~(1U << (seq % 8));
+    count -= (uint32_t)pendingSeqs.size();
+  }
+  pendingSeqs.clear();
+  pendingData.clear();
+  bitmapFirst = present.size();
+  bitmapEnd = 0;
+}
+
+void ResumeStore::discard() {
+  if (!opened)
+    return;
+  if (file.is_open())
+    file.close();
+  std::remove(path.c_str());
+  persisting = false;
+  std::fill(present.begin(), present.end(), 0);
+  count = 0;
+  pendingSeqs.clear();
+  pendingData.clear();
+}
+
+// Reads the header and bitmap only; segments are read back as needed.
+bool ResumeStore::load() {
+  file.open(path, std::fstream::in | std::fstream::out | std::fstream::binary);
+  if (!file.is_open())
+    return false;
+  std::vector<uint8_t> header(HEADER_BYTES);
+  if (!file.read((char *)header.data(), header.size()))
+    return false;
+  FileIdentity stored;
+  stored.size = getWord(header, 8);
+  stored.crc = getWord(header, 12);
+  stored.totalPkts = getWord(header, 16);
+  stored.segmentSize = getWord(header, 20);
+  if (getWord(header, 0) != MAGIC || getWord(header, 4) != VERSION ||
+      !(stored == identity))
+    return false;
+  if (!file.read((char *)present.data(), present.size()))
+    return false;
+
+  for (uint32_t seq = 0; seq < identity.totalPkts; seq++) {
+    if (has(seq))
+      count++;
+  }
+  return true;
+}
+
+// Starts a new file with an empty bitmap; flush fills both in.
+bool ResumeStore::create() {
+  file.clear();
+  file.open(path, std::fstream::in | std::fstream::out | std::fstream::trunc |
+                      std::fstream::binary);
+  if (!file.is_open())
+    return false;
+  std::vector<uint8_t> header;
+  putWord(header, MAGIC);
+  putWord(header, VERSION);
+  putWord(header, identity.size);
+  putWord(header, identity.crc);
+  putWord(header, identity.totalPkts);
+  putWord(header, identity.segmentSize);
+  header.resize(HEADER_BYTES + present.size(), 0);
+  file.write((const char *)header.data(), header.size());
+  return file.good();
+}
+
+uint64_t ResumeStore::offsetOf(uint32_t seq) const {
+  return HEADER_BYTES + present.size() +
+         (uint64_t)seq * identity.segmentSize;
+}
+
+} /* namespace my_protocol */
@@ -0,0 +1,96 @@
+/**
+ * ResumeStore.h
+ *
+ * On-disk copy of the segments a receiver holds, plus a presence bitmap, so
+ * a transfer that aborts can be picked up where it stopped instead of from
+ * the first byte.
+ *
+ * Only the bitmap is kept in memory. Segments put since the last flush wait
+ * in a small buffer; a flush writes just those at their offsets in the file
+ * and then the bitmap bytes they changed, so its cost follows the traffic,
+ * not the file size. The file is only created by the first flush with
+ * anything to write.
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#ifndef ResumeStore_H_
+#define ResumeStore_H_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace my_protocol {
+
+// What, besides the path, a store is keyed by: persisted segments are only
+// reused for exactly the same contents cut into the same segments.
+struct FileIdentity {
+  uint32_t size = 0;
+  uint32_t crc = 0;
+  uint32_t totalPkts = 0;
+  uint32_t segmentSize = 0;
+
+  bool operator==(const FileIdentity &o) const {
+    return size == o.size && crc == o.crc && totalPkts == o.totalPkts &&
+           segmentSize == o.segmentSize;
+  }
+};
+
+class ResumeStore {
+
+public:
+  ResumeStore();
+
+  // Opens the store at path for identity. Segments persisted there for the
+  // same identity are kept; anything else starts empty. Returns the number
+  // of segments recovered.
+  uint32_t open(const std::string &path, const FileIdentity &identity);
+  bool isOpen() const;
+
+  bool has(uint32_t seq) const;
+  uint32_t getCount() const;
+  uint32_t getHighest() const; // highest held seq, 0 if none
+  uint32_t getLength(uint32_t seq) const;
+
+  void put(uint32_t seq, const uint8_t *first, const uint8_t *last);
+  // Reads a held segment back, from the file unless it is still pending.
+  void appendTo(uint32_t seq, std::vector<uint8_t> &out);
+
+  // Writes out the segments put since the last flush. If the file cannot
+  // be written, those segments and any put later are no longer held.
+  void flush();
+  // Removes the persisted copy and holds nothing more, once the transfer
+  // has completed.
+  void discard();
+
+private:
+  static const uint32_t MAGIC = 0x52445452; // "RDTR"
+  static const uint32_t VERSION = 1;
+  static const size_t HEADER_BYTES = 24;
+
+  std::string path;
+  FileIdentity identity;
+  bool opened;
+  bool persisting; // whether put segments are still kept
+  uint32_t count;
+  std::vector<uint8_t> present; // one bit per segment
+  std::fstream file;            // open once loaded or first flushed
+
+  // Segments put since the last flush, each padded to segmentSize, and the
+  // range of bitmap bytes they changed.
+  std::vector<uint32_t> pendingSeqs;
+  std::vector<uint8_t> pendingData;
+  size_t bitmapFirst;
+  size_t bitmapEnd;
+
+  bool load();
+  bool create();
+  uint64_t offsetOf(uint32_t seq) const;
+};
+
+} /* namespace my_protocol */
+
+#endif /* ResumeStore_H_ */
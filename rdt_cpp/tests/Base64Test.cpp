@@ -0,0 +1,193 @@
+/**
+ * Base64Test.cpp
+ *
+ * Checks framework/base64 against the reference coder it replaced, once
+ * with the SSSE3 blocks and once on the table path alone: every length up
+ * to a few blocks and some longer ones, all three tail lengths, integers
+ * with high bits set, and encodings cut short, padded early or broken by
+ * a character outside the alphabet, where decoding must stop.
+ *
+ * Usage: make check   (exits non-zero on the first kind of mismatch)
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#include "../framework/base64.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char ALPHABET[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Characters decoding must stop at, '=' among them.
+const char STOPPERS[] = {'=', '-', '_', ' ', '\n', '\0', '\x80', '\xff'};
+
+// RFC 4648, section 10.
+const char *const VECTORS[][2] = {
+    {"", ""},         {"f", "Zg=="},         {"fo", "Zm8="},
+    {"foo", "Zm9v"},  {"foob", "Zm9vYg=="},  {"fooba", "Zm9vYmE="},
+    {"foobar", "Zm9vYmFy"}};
+
+int failures = 0;
+
+void expect(bool ok, const char *what, size_t length) {
+  if (ok)
+    return;
+  if (failures++ < 10)
+    printf("FAIL %s (length %zu)\n", what, length);
+}
+
+// The coder framework/base64.cpp used before it took blocks at a time:
+// groups of three bytes, the tail padded with '=', decoding up to the
+// first character outside the alphabet.
+std::string referenceEncode(const std::vector<uint8_t> &data) {
+  std::string out;
+  for (size_t i = 0; i < data.size(); i += 3) {
+    size_t n = std::min<size_t>(3, data.size() - i);
+    uint32_t group = data[i] << 16;
+    if (n > 1)
+      group |= data[i + 1] << 8;
+    if (n > 2)
+      group |= data[i + 2];
+    for (size_t j = 0; j < 4; j++)
+      out += j <= n ? ALPHABET[(group >> (18 - 6 * j)) & 0x3F] : '=';
+  }
+  return out;
+}
+
+std::vector<uint8_t> referenceDecode(const std::string &s) {
+  std::vector<uint8_t> out;
+  uint32_t group = 0;
+  size_t n = 0;
+  for (char c : s) {
+    if (!isalnum((unsigned char)c) && c != '+' && c != '/')
+      break;
+    group = group << 6 | (uint32_t)(std::string(ALPHABET).find(c));
+    if (++n == 4) {
+      out.push_back((uint8_t)(group >> 16));
+      out.push_back((uint8_t)(group >> 8));
+      out.push_back((uint8_t)group);
+      group = 0;
+      n = 0;
+    }
+  }
+  // A tail of n characters carries n - 1 bytes.
+  group <<= 6 * (4 - n);
+  for (size_t j = 0; j + 1 < n; j++)
+    out.push_back((uint8_t)(group >> (16 - 8 * j)));
+  return out;
+}
+
+void checkEncode(const std::vector<uint8_t> &data, std::mt19937 &rng) {
+  std::string expected = referenceEncode(data);
+  size_t length = data.size();
+  expect(base64_encoded_length(length) == expected.size(), "encoded length",
+         length);
+
+  std::string out(expected.size() + 1, '#'); // must not write past the end
+  expect(base64_encode(data.data(), length, &out[0]) == expected.size() &&
+             out.compare(0, expected.size(), expected) == 0 &&
+             out.back() == '#',
+         "encode bytes", length);
+
+  // Only the low byte of each integer is encoded.
+  std::vector<int32_t> ints(length);
+  for (size_t i = 0; i < length; i++)
+    ints[i] = (int32_t)(rng() & ~0xFFU) | data[i];
+  expect(base64_encode(ints) == expected, "encode integers", length);
+  expect(base64_encode(ints.data(), length, &out[0]) == expected.size() &&
+             out.compare(0, expected.size(), expected) == 0,
+         "encode integer array", length);
+}
+
+void checkDecode(const std::string &s) {
+  std::vector<uint8_t> expected = referenceDecode(s);
+  size_t length = s.size();
+
+  std::vector<uint8_t> bytes(base64_decoded_length(length) + 1, 0xAA);
+  size_t written = base64_decode(s.data(), length, bytes.data());
+  expect(written == expected.size() &&
+             std::equal(expected.begin(), expected.end(), bytes.begin()) &&
+             written < bytes.size() && bytes[written] == 0xAA,
+         "decode into array", length);
+
+  std::string asString = base64_decode(s);
+  expect(asString == std::string(expected.begin(), expected.end()),
+         "decode into string", length);
+
+  std::vector<uint8_t> asBytes(5, 1); // replaced, not appended to
+  base64_decode(s.data(), length, asBytes);
+  expect(asBytes == expected, "decode into bytes", length);
+
+  std::vector<int32_t> asInts(5, -1);
+  base64_decode(s.data(), length, asInts);
+  expect(asInts == std::vector<int32_t>(expected.begin(), expected.end()),
+         "decode into integers", length);
+}
+
+// The same inputs on each pass.
+void checkAll() {
+  std::mt19937 rng(1);
+  for (const auto &vector : VECTORS) {
+    std::string text = vector[0];
+    std::vector<uint8_t> data(text.begin(), text.end());
+    expect(referenceEncode(data) == vector[1], "reference encoder",
+           text.size());
+    checkEncode(data, rng);
+    checkDecode(vector[1]);
+  }
+
+  std::vector<size_t> lengths;
+  for (size_t length = 0; length <= 200; length++)
+    lengths.push_back(length);
+  for (int i = 0; i < 50; i++)
+    lengths.push_back(rng() % 5000);
+
+  for (size_t length : lengths) {
+    std::vector<uint8_t> data(length);
+    for (uint8_t &b : data)
+      b = (uint8_t)rng();
+    checkEncode(data, rng);
+
+    std::string encoded = referenceEncode(data);
+    checkDecode(encoded);
+    // Unpadded, and cut to every tail length, including a lone character.
+    for (size_t cut = 1; cut <= 4 && cut <= encoded.size(); cut++)
+      checkDecode(encoded.substr(0, encoded.size() - cut));
+    if (encoded.empty())
+      continue;
+    // Stopped early, inside or at the edge of a 16-character block.
+    for (char stopper : STOPPERS) {
+      std::string broken = encoded;
+      broken[rng() % broken.size()] = stopper;
+      checkDecode(broken);
+    }
+  }
+}
+
+} // namespace
+
+int main() {
+  bool ssse3 = base64_use_ssse3(true);
+  checkAll();
+  if (ssse3) {
+    base64_use_ssse3(false);
+    checkAll();
+  }
+
+  if (failures != 0) {
+    printf("%d mismatches\n", failures);
+    return 1;
+  }
+  printf("base64 matches the reference coder%s\n",
+         ssse3 ? " with and without SSSE3" : " (no SSSE3 here)");
+  return 0;
+}
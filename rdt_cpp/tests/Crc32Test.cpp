@@ -0,0 +1,91 @@
+/**
+ * Crc32Test.cpp
+ *
+ * Checks every CRC32 kernel in framework/crc32 against the bytewise
+ * reference: random lengths (long enough to reach the PCLMULQDQ fold),
+ * misaligned starts and seeds, and crc32_combine at random split points.
+ * One checksum is taken during static initialisation, before crc32.cpp
+ * may have chosen its kernel, to keep that dispatch covered too.
+ *
+ * Usage: make check   (exits non-zero on the first kind of mismatch)
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#include "../framework/crc32.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+const char CHECK_INPUT[] = "123456789";
+const uint32_t CHECK_VALUE = 0xCBF43926; // the standard CRC-32 check value
+
+// Above the 64 bytes where crc32_fast starts folding, with a ragged tail.
+const char STATIC_INPUT[] =
+    "The checksum of this text is taken before main, while the order in "
+    "which translation units initialise is still unspecified.";
+const uint32_t staticFast =
+    crc32_fast(STATIC_INPUT, sizeof(STATIC_INPUT) - 1, 0);
+
+int failures = 0;
+
+void expect(bool ok, const char *what, size_t length, size_t offset) {
+  if (ok)
+    return;
+  if (failures++ < 10)
+    printf("FAIL %s: length %zu, offset %zu\n", what, length, offset);
+}
+
+} // namespace
+
+int main() {
+  printf("crc32_fast %s PCLMULQDQ\n",
+         crc32_fast_uses_pclmul() ? "folds with" : "does not use");
+
+  expect(crc32_1byte(CHECK_INPUT, 9, 0) == CHECK_VALUE, "check value", 9, 0);
+  expect(crc32_fast(CHECK_INPUT, 9, 0) == CHECK_VALUE, "fast check value", 9,
+         0);
+  expect(staticFast ==
+             crc32_1byte(STATIC_INPUT, sizeof(STATIC_INPUT) - 1, 0),
+         "static initialisation", sizeof(STATIC_INPUT) - 1, 0);
+
+  std::mt19937 rng(1);
+  std::vector<uint8_t> buffer(1 << 16);
+  for (uint8_t &b : buffer)
+    b = (uint8_t)rng();
+
+  for (int round = 0; round < 20000; round++) {
+    // Mostly short, sometimes long enough for several folding rounds.
+    size_t length = round % 8 == 0 ? rng() % 60000 : rng() % 3000;
+    size_t offset = rng() % 64;
+    uint32_t seed = round % 3 == 0 ? 0 : rng();
+    const uint8_t *data = buffer.data() + offset;
+
+    uint32_t reference = crc32_1byte(data, length, seed);
+    expect(crc32_8bytes(data, length, seed) == reference, "crc32_8bytes",
+           length, offset);
+    expect(crc32_16bytes(data, length, seed) == reference, "crc32_16bytes",
+           length, offset);
+    expect(crc32_fast(data, length, seed) == reference, "crc32_fast", length,
+           offset);
+
+    size_t split = length == 0 ? 0 : rng() % (length + 1);
+    uint32_t first = crc32_1byte(data, split, 0);
+    uint32_t second = crc32_1byte(data + split, length - split, 0);
+    expect(crc32_combine(first, second, length - split) ==
+               crc32_1byte(data, length, 0),
+           "crc32_combine", length, offset);
+  }
+
+  if (failures != 0) {
+    printf("%d mismatches\n", failures);
+    return 1;
+  }
+  printf("all CRC32 kernels match the bytewise reference\n");
+  return 0;
+}
@@ -0,0 +1,144 @@
+/**
+ * ResumeStoreTest.cpp
+ *
+ * Round-trips segments through my_protocol::ResumeStore: put, read back
+ * before and after a flush, reopen under the same and a different
+ * identity, add to a recovered store, and discard. Also checks that a
+ * store whose file cannot be written claims no segment it did not write.
+ *
+ * Usage: make check   (exits non-zero on the first kind of mismatch)
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#include "../my_protocol/ResumeStore.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <vector>
+
+namespace {
+
+const char PATH[] = "rdtcResumeTest.part";
+const char UNWRITABLE_PATH[] = "no-such-directory/rdtcResumeTest.part";
+
+int failures = 0;
+
+void expect(bool ok, const char *what) {
+  if (ok)
+    return;
+  if (failures++ < 10)
+    printf("FAIL %s\n", what);
+}
+
+bool fileExists(const char *path) { return std::ifstream(path).good(); }
+
+// 20 segments of 100 bytes, the last one 37 bytes long.
+my_protocol::FileIdentity testIdentity() {
+  my_protocol::FileIdentity identity;
+  identity.size = 19 * 100 + 37;
+  identity.crc = 0x12345678;
+  identity.totalPkts = 20;
+  identity.segmentSize = 100;
+  return identity;
+}
+
+void put(my_protocol::ResumeStore &store, const std::vector<uint8_t> &file,
+         uint32_t seq) {
+  const uint8_t *first = file.data() + seq * 100;
+  store.put(seq, first, first + store.getLength(seq));
+}
+
+bool holdsSegment(my_protocol::ResumeStore &store,
+                  const std::vector<uint8_t> &file, uint32_t seq) {
+  std::vector<uint8_t> out(3, 0xAA); // appendTo must keep what is there
+  store.appendTo(seq, out);
+  uint32_t length = store.getLength(seq);
+  return store.has(seq) && out.size() == 3 + length && out[0] == 0xAA &&
+         std::equal(out.begin() + 3, out.end(), file.begin() + seq * 100);
+}
+
+} // namespace
+
+int main() {
+  std::remove(PATH);
+  std::mt19937 rng(1);
+  std::vector<uint8_t> file(testIdentity().size);
+  for (uint8_t &b : file)
+    b = (uint8_t)rng();
+
+  {
+    my_protocol::ResumeStore store;
+    expect(store.open(PATH, testIdentity()) == 0, "fresh store is empty");
+    store.flush();
+    expect(!fileExists(PATH), "flush with nothing put creates no file");
+
+    for (uint32_t seq : {0U, 3U, 19U, 7U})
+      put(store, file, seq);
+    put(store, file, 3); // again, ignored
+    expect(store.getCount() == 4, "count after put");
+    expect(store.getHighest() == 19, "highest after put");
+    expect(store.getLength(19) == 37, "short last segment");
+    expect(holdsSegment(store, file, 7), "pending segment reads back");
+    expect(!store.has(1), "segment never put");
+
+    store.flush();
+    expect(fileExists(PATH), "flush creates the file");
+    expect(holdsSegment(store, file, 19), "flushed segment reads back");
+    put(store, file, 12);
+    store.flush();
+  }
+
+  {
+    my_protocol::ResumeStore store;
+    expect(store.open(PATH, testIdentity()) == 5, "reopen recovers all");
+    for (uint32_t seq : {0U, 3U, 7U, 12U, 19U})
+      expect(holdsSegment(store, file, seq), "recovered segment matches");
+    expect(!store.has(4), "recovered store has no extra segments");
+
+    put(store, file, 4);
+    store.flush();
+  }
+
+  {
+    my_protocol::FileIdentity other = testIdentity();
+    other.crc++;
+    my_protocol::ResumeStore store;
+    expect(store.open(PATH, other) == 0, "other identity starts empty");
+  }
+
+  {
+    my_protocol::ResumeStore store;
+    expect(store.open(PATH, testIdentity()) == 6, "additions recovered");
+    expect(holdsSegment(store, file, 4), "added segment matches");
+    store.discard();
+    expect(!fileExists(PATH), "discard removes the file");
+    expect(!store.has(4) && store.getCount() == 0, "discard holds nothing");
+  }
+
+  {
+    my_protocol::ResumeStore store;
+    expect(store.open(UNWRITABLE_PATH, testIdentity()) == 0,
+           "unwritable store is empty");
+    put(store, file, 2);
+    put(store, file, 5);
+    expect(store.has(2) && store.getCount() == 2, "held until flushed");
+    store.flush();
+    expect(!store.has(2) && !store.has(5), "failed flush holds nothing");
+    expect(store.getCount() == 0 && store.getHighest() == 0,
+           "failed flush counts nothing");
+    put(store, file, 6);
+    expect(!store.has(6), "nothing is held after a failed flush");
+  }
+
+  std::remove(PATH);
+  if (failures != 0) {
+    printf("%d mismatches\n", failures);
+    return 1;
+  }
+  printf("ResumeStore round-trips and fails cleanly\n");
+  return 0;
+}
@@ -0,0 +1,143 @@
+/**
+ * TraceQlog.cpp
+ *
+ * Converts a binary trace written by framework::TraceRing into qlog JSON,
+ * which qvis and similar viewers plot as sequence numbers against time.
+ * Events are mapped to their nearest qlog transport and recovery events,
+ * with segment numbers as packet numbers; those qlog has no name for are
+ * kept under the "rdt" category.
+ *
+ * Usage: traceqlog trace.bin [out.qlog]   (writes to stdout without out)
+ */
+
+//Nicolae Iovu , s3707792
+//Ilia Mirzaali, s3534162
+
+#include "../framework/Trace.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The qlog name and data object of one event.
+void writeEvent(std::ostream &out, const framework::TraceEvent &e) {
+  out << "\"time\": " << e.timeNs / 1000000 << '.';
+  char fraction[8];
+  snprintf(fraction, sizeof(fraction), "%06u",
+           (unsigned)(e.timeNs % 1000000));
+  out << fraction << ", ";
+
+  switch (e.type) {
+  case framework::TRACE_PACKET_SENT:
+  case framework::TRACE_RETRANSMIT:
+    out << "\"name\": \"transport:packet_sent\", \"data\": {\"header\": "
+        << "{\"packet_type\": \"data\", \"packet_number\": " << e.seq
+        << "}, \"trigger\": \""
+        << (e.type == framework::TRACE_RETRANSMIT ? "retransmit" : "new")
+        << "\", \"congestion_window\": " << e.value << "}";
+    break;
+  case framework::TRACE_PACKET_LOST:
+  case framework::TRACE_TIMEOUT:
+    out << "\"name\": \"recovery:packet_lost\", \"data\": {\"header\": "
+        << "{\"packet_type\": \"data\", \"packet_number\": " << e.seq
+        << "}, \"trigger\": \""
+        << (e.type == framework::TRACE_TIMEOUT ? "pto_expired"
+                                               : "reordering_threshold")
+        << "\"";
+    if (e.type == framework::TRACE_TIMEOUT)
+      out << ", \"rto_ms\": " << e.value << "}";
+    else
+      out << ", \"congestion_window\": " << e.value << "}";
+    break;
+  case framework::TRACE_ACK_RECEIVED:
+  case framework::TRACE_ACK_SENT:
+    out << "\"name\": \""
+        << (e.type == framework::TRACE_ACK_SENT ? "transport:packet_sent"
+                                                : "transport:packet_received")
+        << "\", \"data\": {\"header\": {\"packet_type\": \"ack\"}, "
+        << "\"frames\": [{\"frame_type\": \"ack\", \"ack_base\": " << e.seq
+        << ", \"window\": " << e.value << "}]}";
+    break;
+  case framework::TRACE_SACK_GAP:
+    out << "\"name\": \"rdt:sack_gap\", \"data\": {\"first_missing\": "
+        << e.seq << ", \"missing\": " << e.value << "}";
+    break;
+  case framework::TRACE_WINDOW:
+    out << "\"name\": \"recovery:metrics_updated\", \"data\": "
+        << "{\"congestion_window\": " << e.value
+        << ", \"packets_in_flight\": " << e.seq << "}";
+    break;
+  case framework::TRACE_DATA_RECEIVED:
+  case framework::TRACE_DUPLICATE:
+    out << "\"name\": \"transport:packet_received\", \"data\": {\"header\": "
+        << "{\"packet_type\": \"data\", \"packet_number\": " << e.seq << "}";
+    if (e.type == framework::TRACE_DUPLICATE)
+      out << ", \"duplicate\": true}";
+    else
+      out << ", \"raw\": {\"payload_length\": " << e.value << "}}";
+    break;
+  case framework::TRACE_CLIENT_TRANSMIT:
+    out << "\"name\": \"transport:datagrams_sent\", \"data\": {\"count\": 1, "
+        << "\"raw\": [{\"length\": " << e.value << "}], \"queued_bytes\": "
+        << e.seq << "}";
+    break;
+  case framework::TRACE_CLIENT_PACKET:
+    out << "\"name\": \"transport:datagrams_received\", \"data\": "
+        << "{\"count\": 1, \"raw\": [{\"length\": " << e.value
+        << "}], \"queued_packets\": " << e.seq << "}";
+    break;
+  default:
+    out << "\"name\": \"rdt:unknown\", \"data\": {\"type\": " << (int)e.type
+        << ", \"seq\": " << e.seq << ", \"value\": " << e.value << "}";
+    break;
+  }
+  out << ", \"thread\": " << (int)e.thread;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: traceqlog trace.bin [out.qlog]" << std::endl;
+    return 2;
+  }
+
+  std::vector<framework::TraceEvent> events;
+  uint64_t startUnixNs = 0;
+  if (!framework::TraceRing::readFile(argv[1], events, startUnixNs)) {
+    std::cerr << "Not a readable trace: " << argv[1] << std::endl;
+    return 1;
+  }
+
+  std::ofstream file;
+  if (argc > 2) {
+    file.open(argv[2], std::ofstream::trunc);
+    if (!file.good()) {
+      std::cerr << "Cannot write " << argv[2] << std::endl;
+      return 1;
+    }
+  }
+  std::ostream &out = argc > 2 ? file : std::cout;
+
+  out << "{\"qlog_version\": \"0.3\", \"qlog_format\": \"JSON\", "
+      << "\"title\": \"rdt trace\", \"traces\": [{"
+      << "\"vantage_point\": {\"type\": \"network\"}, "
+      << "\"common_fields\": {\"time_format\": \"relative\", "
+      << "\"reference_time\": " << startUnixNs / 1000000 << '.';
+  char fraction[8];
+  snprintf(fraction, sizeof(fraction), "%06u",
+           (unsigned)(startUnixNs % 1000000));
+  out << fraction << "}, \"events\": [";
+  for (size_t i = 0; i < events.size(); i++) {
+    out << (i == 0 ? "\n" : ",\n") << "  {";
+    writeEvent(out, events[i]);
+    out << "}";
+  }
+  out << "\n]}]}\n";
+  out.flush();
+  return out.good() ? 0 : 1;
+}